@@ -11,6 +11,8 @@
 
 #include "color.h"
 #include "direction.h"
+#include "neighborhood.h"
+#include "perception.h"
 
 /**
  * Base class for a specific instance of a game object.  
@@ -28,7 +30,7 @@
 class critter {
   private:
     std::string name_;            /**< Name of this critter */
-    color color_;                 /**< Color of this critter */
+    ::color color_;               /**< Color of this critter */
     char glyph_;                  /**< Symbol displayed for a critter */
     bool updated_;                /**< Has this critter already been updated? */
 
@@ -58,7 +60,7 @@ class critter {
      */
     explicit critter(const std::string& name) 
       : name_(name)
-        , color_(color::WHITE)
+        , color_(::color::WHITE)
         , glyph_('x')
         , updated_(false)
         , awake_(true)
@@ -155,6 +157,52 @@ class critter {
       assert (!neighbors.empty());
       return direction::CENTER;
     }
+
+    /**
+     * Informs the simulator how far every critter of this species can see.
+     * Critters that see further than their immediate neighbors should
+     * override both this and survey.
+     *
+     * This is a property of the species: it must return the same value for
+     * every critter of a class, every turn.
+     *
+     * @return the vision radius. 0 or 1 means only the immediate neighbors are visible.
+     */
+    virtual int vision_radius() const {
+      return 0;
+    }
+
+    /**
+     * Informs the simulator of any movement a critter wants to take during a turn,
+     * given a view of everything within its vision radius.
+     *
+     * The simulator calls survey exactly once each turn, in place of move.
+     * By default, it ignores what the critter sees and calls move.
+     *
+     * @param neighbors A map of what is in the neighoring tiles around this critter.
+     * @param sight A window onto every tile within vision_radius() of this critter.
+     * @return the Direction this critter should move this turn
+     */
+    virtual direction survey(const std::map<direction, std::shared_ptr<critter>>& neighbors,
+                             [[maybe_unused]] const perception& sight) {
+      return move(neighbors);
+    }
+
+    /**
+     * Informs the simulator of the movement of every awake member of this species at once.
+     *
+     * Each turn, the simulator gathers every member of a species that can move
+     * and calls move_batch once, on the critter originally added to the game,
+     * before any of them have moved.
+     * Overriding it lets a species make all of its decisions in one place,
+     * for example with vectorized code.
+     * By default, it calls survey on each member in turn.
+     *
+     * @param views what each member sees; views[i].self is the member
+     * @param[out] moves the direction each member should move this turn
+     * @param count the number of members in the batch
+     */
+    virtual void move_batch(const neighborhood* views, direction* moves, std::size_t count);
     /**
      * Informs the simulator of the critter color.
      *
@@ -300,6 +348,45 @@ class critter {
      */
     void tick();
 
+    /**
+     * Update critter state variables as if tick() were called several times.
+     * Only valid while the critter would stay asleep or mating, and not starve,
+     * for every one of those turns.
+     * @param turns the number of time steps to skip
+     */
+    void tick(int turns);
+
+    /**
+     * The state the simulator keeps for every critter.
+     * Used to save a game and restore it later.
+     */
+    struct state {
+      bool awake;           /**< is the critter awake? */
+      bool mating;          /**< is the critter mating? */
+      bool has_mated;       /**< has the critter mated? */
+      int  baby_timer;      /**< turns left as a newborn */
+      int  food_remaining;  /**< food reserves remaining */
+      int  wait_time;       /**< turns left before the critter can act */
+    };
+    /**
+     * @return the state the simulator keeps for this critter
+     */
+    state save_state() const {
+      return state {awake_, mating_, has_mated_, baby_timer_, food_remaining_, wait_time_};
+    }
+    /**
+     * Replace the state the simulator keeps for this critter.
+     * State kept by derived classes is not affected.
+     */
+    void restore_state(const state& s) {
+      awake_ = s.awake;
+      mating_ = s.mating;
+      has_mated_ = s.has_mated;
+      baby_timer_ = s.baby_timer;
+      food_remaining_ = s.food_remaining;
+      wait_time_ = s.wait_time;
+    }
+
 
 };
 
@@ -0,0 +1,52 @@
+#ifndef MESA_CRITTERS_NEIGHBORHOOD_H
+#define MESA_CRITTERS_NEIGHBORHOOD_H
+
+#include <array>
+#include <map>
+#include <memory>
+
+#include "direction.h"
+#include "perception.h"
+
+class critter;
+
+/**
+ * Everything one critter sees when the simulator asks it to move.
+ *
+ * A neighborhood points into the simulator's tile storage rather than copying it,
+ * and is only valid for the duration of the call it is passed to.
+ *
+ * @see critter::move_batch
+ */
+struct neighborhood {
+  critter* self = nullptr;              /**< the critter being asked to move */
+  /**
+   * The contents of the 8 surrounding tiles,
+   * in the same order as the directions array.
+   */
+  std::array<const std::shared_ptr<critter>*, 8> neighbors {};
+  perception sight;                     /**< everything within the critter's vision radius */
+
+  /**
+   * Look at a neighboring tile.
+   * @param i the position of the direction in the directions array
+   * @return the contents of the tile
+   */
+  const std::shared_ptr<critter>& operator[](std::size_t i) const {
+    return *neighbors[i];
+  }
+
+  /**
+   * Copy the neighboring tiles into the map critter::move expects.
+   * @return a map from each direction to the contents of the tile in that direction
+   */
+  std::map<direction, std::shared_ptr<critter>> to_map() const {
+    std::map<direction, std::shared_ptr<critter>> result;
+    for (std::size_t i = 0; i < directions.size(); ++i) {
+      result[directions[i]] = *neighbors[i];
+    }
+    return result;
+  }
+};
+
+#endif
@@ -0,0 +1,197 @@
+#ifndef MESA_CRITTERS_PERCEPTION_H
+#define MESA_CRITTERS_PERCEPTION_H
+
+#include <cassert>
+#include <memory>
+#include <string>
+
+#include "direction.h"
+
+class critter;
+
+/**
+ * A read-only window onto the tiles within some radius of a critter.
+ *
+ * The window reads directly from the simulator's tile storage; nothing is copied
+ * when it is made, so the cost of looking further is only paid for the tiles a
+ * critter actually reads.
+ * A window is only valid for the duration of the call it is passed to.
+ *
+ * Offsets are relative to the critter: x increases to the east and y increases
+ * to the south, and the world wraps around just as it does for movement.
+ *
+ * Beyond the window, the simulator keeps track of how far every tile is from the
+ * nearest food and the nearest member of each species, so finding the way to
+ * either takes constant time no matter how far away it is.
+ * Targets more than 254 moves away are out of range.
+ * It can also count what occupies any rectangle of the world.
+ *
+ * @see critter::vision_radius
+ * @see critter::survey
+ */
+class perception {
+  public:
+    /**
+     * Answers questions about the world beyond the window.
+     * Implemented by the simulator.
+     */
+    class oracle {
+      public:
+        /**
+         * Destroy oracle resources.
+         */
+        virtual ~oracle() = default;
+        /**
+         * Look at a tile.
+         * @param x the x-coordinate of the tile, inside the world
+         * @param y the y-coordinate of the tile, inside the world
+         * @return the contents of the tile
+         */
+        virtual const std::shared_ptr<critter>& at(int x, int y) const = 0;
+        /**
+         * Find the first step on a shortest path toward a target.
+         * @param target "Food" or the name of a species
+         * @param x the x-coordinate of the starting tile
+         * @param y the y-coordinate of the starting tile
+         * @return the direction to move, or CENTER if no target is in range
+         */
+        virtual direction toward(const std::string& target, int x, int y) const = 0;
+        /**
+         * Find the step that moves furthest from a target.
+         * @param target "Food" or the name of a species
+         * @param x the x-coordinate of the starting tile
+         * @param y the y-coordinate of the starting tile
+         * @return the direction to move, or CENTER if no target is in range
+         *         or no step gets further away
+         */
+        virtual direction away_from(const std::string& target, int x, int y) const = 0;
+        /**
+         * Find the number of moves to the nearest target.
+         * @param target "Food" or the name of a species
+         * @param x the x-coordinate of the starting tile
+         * @param y the y-coordinate of the starting tile
+         * @return the number of moves, or -1 if no target is in range
+         */
+        virtual int distance(const std::string& target, int x, int y) const = 0;
+        /**
+         * Count the tiles holding something in a rectangle.
+         * The rectangle wraps around the world edges.
+         * @param target "Empty", "Food", "Stone" or the name of a species
+         * @param x0 the left column
+         * @param y0 the top row
+         * @param x1 the right column, inclusive
+         * @param y1 the bottom row, inclusive
+         * @return the number of matching tiles
+         */
+        virtual int count(const std::string& target, int x0, int y0, int x1, int y1) const = 0;
+    };
+
+    /**
+     * A window that sees nothing.
+     */
+    perception() = default;
+
+    /**
+     * Create a window onto the world.
+     * Used by the simulator, not players.
+     * @param width the world width
+     * @param height the world height
+     * @param x the x-coordinate at the center of the window
+     * @param y the y-coordinate at the center of the window
+     * @param radius how far the window reaches in each direction.
+     *        Must be less than half the world width and height.
+     * @param oracle reads tiles and answers questions about the world
+     */
+    perception(int width, int height, int x, int y, int radius, const oracle* oracle)
+      : oracle_(oracle)
+        , width_(width)
+        , height_(height)
+        , x_(x)
+        , y_(y)
+        , radius_(radius)
+    {
+      assert (2*radius < width && 2*radius < height);
+    }
+
+    /**
+     * How far this window reaches from its center.
+     * A window of radius r covers (2r+1) x (2r+1) tiles.
+     * @return the radius of this window
+     */
+    int radius() const { return radius_; }
+
+    /**
+     * Look at a tile relative to the center of the window.
+     * @param dx the column offset, from -radius() to radius()
+     * @param dy the row offset, from -radius() to radius()
+     * @return the contents of the tile
+     */
+    const std::shared_ptr<critter>& at(int dx, int dy) const {
+      assert (oracle_ != nullptr);
+      assert (dx >= -radius_ && dx <= radius_ && dy >= -radius_ && dy <= radius_);
+      int x = x_ + dx;
+      int y = y_ + dy;
+      x += width_  * (x < 0);
+      x -= width_  * (x >= width_);
+      y += height_ * (y < 0);
+      y -= height_ * (y >= height_);
+      return oracle_->at(x, y);
+    }
+
+    /**
+     * Find the first step on a shortest path toward the nearest food.
+     * Paths go around stones, but not around other critters.
+     * @return the direction to move, or CENTER if no food is in range
+     */
+    direction toward_food() const { return toward("Food"); }
+    /**
+     * Find the first step on a shortest path toward the nearest member of a species.
+     * A critter counts as the nearest member of its own species.
+     * @param target the name of the species, or "Food"
+     * @return the direction to move, or CENTER if none are in range
+     */
+    direction toward(const std::string& target) const {
+      return oracle_ == nullptr? direction::CENTER: oracle_->toward(target, x_, y_);
+    }
+    /**
+     * Find the step that gets furthest from the nearest member of a species.
+     * @param target the name of the species, or "Food"
+     * @return the direction to move, or CENTER if none are in range
+     */
+    direction away_from(const std::string& target) const {
+      return oracle_ == nullptr? direction::CENTER: oracle_->away_from(target, x_, y_);
+    }
+    /**
+     * Find the number of moves to the nearest member of a species.
+     * @param target the name of the species, or "Food"
+     * @return the number of moves, or -1 if none are in range
+     */
+    int distance_to(const std::string& target) const {
+      return oracle_ == nullptr? -1: oracle_->distance(target, x_, y_);
+    }
+    /**
+     * Count the tiles holding something in a rectangle relative to the critter.
+     * The rectangle is not limited to the window.
+     * For example, count("Empty", -3, 0, 3, 0) counts the free tiles
+     * within 3 columns either side in the critter's own row.
+     * @param target "Empty", "Food", "Stone" or the name of a species
+     * @param dx0 the left column offset
+     * @param dy0 the top row offset
+     * @param dx1 the right column offset, inclusive
+     * @param dy1 the bottom row offset, inclusive
+     * @return the number of matching tiles
+     */
+    int count(const std::string& target, int dx0, int dy0, int dx1, int dy1) const {
+      return oracle_ == nullptr? 0: oracle_->count(target, x_ + dx0, y_ + dy0, x_ + dx1, y_ + dy1);
+    }
+
+  private:
+    const oracle* oracle_ = nullptr;                    /**< reads tiles and answers questions */
+    int width_ = 0;                                     /**< world width */
+    int height_ = 0;                                    /**< world height */
+    int x_ = 0;                                         /**< column at the center */
+    int y_ = 0;                                         /**< row at the center */
+    int radius_ = 0;                                    /**< reach in each direction */
+};
+
+#endif
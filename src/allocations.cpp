@@ -0,0 +1,89 @@
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+#include "allocations.h"
+
+const std::array<const char*, allocations::phases> allocations::names = {
+  "other", "wake", "age", "look", "move", "act", "history", "view", "record", "report", "checkpoint"
+};
+
+#ifdef CRITTERS_TRACK_ALLOCATIONS
+namespace {
+  // zero initialized and trivial, so it is safe to touch from operator new on any thread
+  thread_local allocations::table used;
+
+  void charge(std::size_t size) {
+    auto& c = used[allocations::current_];
+    ++c.allocations;
+    c.bytes += size;
+  }
+} // end anonymous namespace
+
+void* operator new(std::size_t size) {
+  charge(size);
+  if (auto* p = std::malloc(size == 0? 1: size)) return p;
+  throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  charge(size);
+  return std::malloc(size == 0? 1: size);
+}
+
+void* operator new(std::size_t size, std::align_val_t align) {
+  charge(size);
+  // aligned_alloc wants a multiple of the alignment
+  auto a = static_cast<std::size_t>(align);
+  if (auto* p = std::aligned_alloc(a, (size + a - 1) / a * a)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+allocations::table allocations::counts() {
+  return used;
+}
+#else
+allocations::table allocations::counts() {
+  return table {};
+}
+#endif
+
+allocations::table operator-(const allocations::table& a, const allocations::table& b) {
+  allocations::table d;
+  for (std::size_t i = 0; i < d.size(); ++i) {
+    d[i].allocations = a[i].allocations - b[i].allocations;
+    d[i].bytes = a[i].bytes - b[i].bytes;
+  }
+  return d;
+}
+
+void allocations::summary(std::ostream& os, const table& used, unsigned long ticks,
+                          uint64_t worst, unsigned long worst_tick) {
+  if (ticks == 0) return;
+  auto flags = os.flags();
+  os << "Heap allocations per tick over " << ticks << " ticks:\n"
+     << std::left << std::setw(12) << "phase" << std::right
+     << std::setw(14) << "allocations" << std::setw(14) << "bytes" << '\n'
+     << std::fixed << std::setprecision(1);
+  count total;
+  for (std::size_t i = 0; i < used.size(); ++i) {
+    total.allocations += used[i].allocations;
+    total.bytes += used[i].bytes;
+    if (used[i].allocations == 0) continue;
+    os << std::left << std::setw(12) << names[i] << std::right
+       << std::setw(14) << double(used[i].allocations) / double(ticks)
+       << std::setw(14) << double(used[i].bytes) / double(ticks) << '\n';
+  }
+  os << std::left << std::setw(12) << "total" << std::right
+     << std::setw(14) << double(total.allocations) / double(ticks)
+     << std::setw(14) << double(total.bytes) / double(ticks) << '\n'
+     << "The most in one tick: " << worst << ", in tick " << worst_tick << ".\n";
+  os.flags(flags);
+}
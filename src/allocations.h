@@ -0,0 +1,107 @@
+#ifndef MESA_CRITTERS_ALLOCATIONS_H
+#define MESA_CRITTERS_ALLOCATIONS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+/**
+ * Counts heap allocations, and the bytes asked for, by the engine phase that made them.
+ *
+ * Built in only with the TRACK_ALLOCATIONS CMake option, which replaces the
+ * global operator new and operator delete with ones that count, then call
+ * malloc and free.  Counts are kept per thread, so threads don't contend.
+ * Without the option nothing is replaced, and a phase costs nothing.
+ *
+ * The phase is set by a scope for as long as it lives;
+ * allocations outside any scope count as OTHER.
+ */
+class allocations {
+  public:
+#ifdef CRITTERS_TRACK_ALLOCATIONS
+    static constexpr bool tracked = true;     /**< true if allocations are counted */
+#else
+    static constexpr bool tracked = false;    /**< true if allocations are counted */
+#endif
+
+    /**
+     * The parts of a tick allocations are charged to.
+     */
+    enum phase : uint8_t {
+      OTHER,          /**< outside any phase */
+      WAKE,           /**< waking sleeping critters */
+      AGE,            /**< aging the critters of a species, and starving them */
+      LOOK,           /**< building what each critter sees */
+      MOVE,           /**< the critters' own code deciding their moves */
+      ACT,            /**< moving, fighting, eating and mating */
+      HISTORY,        /**< keeping the recent past */
+      VIEW,           /**< updating the display */
+      RECORD,         /**< recording species counters */
+      REPORT,         /**< publishing metrics and the shared world */
+      CHECKPOINT,     /**< saving checkpoints */
+      phases          /**< the number of phases */
+    };
+    /**
+     * The name of each phase.
+     */
+    static const std::array<const char*, phases> names;
+
+    /**
+     * Allocations and bytes of one phase.
+     */
+    struct count {
+      uint64_t allocations = 0;   /**< calls to operator new */
+      uint64_t bytes = 0;         /**< bytes asked for */
+    };
+    /**
+     * The counts of every phase.
+     */
+    using table = std::array<count, phases>;
+
+    /**
+     * Charges allocations to a phase while it lives, then to the phase before.
+     */
+    class scope {
+      public:
+#ifdef CRITTERS_TRACK_ALLOCATIONS
+        explicit scope(phase p) : previous_(current_) { current_ = p; }
+        ~scope() { current_ = previous_; }
+#else
+        explicit scope(phase) {}
+#endif
+        scope(const scope&) = delete;
+        scope& operator=(const scope&) = delete;
+#ifdef CRITTERS_TRACK_ALLOCATIONS
+      private:
+        phase previous_;    /**< the phase to go back to */
+#endif
+    };
+
+    /**
+     * @return the counts of this thread so far; all zero if not tracked
+     */
+    static table counts();
+
+    /**
+     * Write a summary of allocations per tick.
+     * @param os where to write
+     * @param used the counts over the ticks
+     * @param ticks the number of ticks
+     * @param worst the most allocations in a single tick
+     * @param worst_tick the tick they were made in
+     */
+    static void summary(std::ostream& os, const table& used, unsigned long ticks,
+                        uint64_t worst, unsigned long worst_tick);
+
+#ifdef CRITTERS_TRACK_ALLOCATIONS
+    static thread_local inline phase current_ = OTHER;   /**< the phase of this thread */
+#endif
+};
+
+/**
+ * @return the counts of a less those of b
+ */
+allocations::table operator-(const allocations::table& a, const allocations::table& b);
+
+#endif
@@ -0,0 +1,25 @@
+#include "cell.h"
+
+cell cell::of(const critter& it) {
+  auto c = it.color();
+  // view_curses draws black critters in its default pair
+  if (c == color::BLACK) c = color::WHITE;
+
+  cell result;
+  result.glyph = it.glyph();
+  if (it.is_asleep() && it.is_mating()) {
+    // view_curses has no pair for this, and falls back to the default colors
+  } else if (it.is_asleep()) {
+    result.fg = uint8_t(color::BLACK);
+    result.bg = uint8_t(c);
+  } else if (it.is_mating()) {
+    // view_curses pairs 23 and 27 differ from the pattern
+    if (c == color::RED)          c = color::BLACK;
+    else if (c == color::MAGENTA) c = color::WHITE;
+    result.fg = uint8_t(c);
+    result.bg = uint8_t(color::RED);
+  } else {
+    result.fg = uint8_t(c);
+  }
+  return result;
+}
@@ -0,0 +1,42 @@
+#ifndef MESA_CRITTERS_CELL_H
+#define MESA_CRITTERS_CELL_H
+
+#include <cstdint>
+
+#include "color.h"
+#include "critter.h"
+
+/**
+ * How one tile looks on a character display: a glyph and its colors.
+ * Colors are stored as their position in the color enum.
+ */
+struct cell {
+  char glyph = ' ';                               /**< the character shown */
+  uint8_t fg = uint8_t(color::WHITE);             /**< the foreground color */
+  uint8_t bg = uint8_t(color::BLACK);             /**< the background color */
+
+  /**
+   * Get how a critter is drawn, which depends on its state.
+   * Sleeping critters are shown reversed, and mating critters on red,
+   * as in view_curses::adjust_color.
+   * @param it the critter
+   * @return the cell showing it
+   */
+  static cell of(const critter& it);
+
+  /**
+   * @return the foreground color
+   */
+  color foreground() const { return color(fg); }
+  /**
+   * @return the background color
+   */
+  color background() const { return color(bg); }
+
+  bool operator==(const cell& rhs) const {
+    return glyph == rhs.glyph && fg == rhs.fg && bg == rhs.bg;
+  }
+  bool operator!=(const cell& rhs) const { return !(*this == rhs); }
+};
+
+#endif
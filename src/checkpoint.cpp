@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+
+namespace {
+  const std::string prefix = "checkpoint-";
+  const std::string suffix = ".crck";
+} // end anonymous namespace
+
+void checkpoint_out::put(uint64_t v, int n) {
+  char buf[8];
+  for (int i = 0; i < n; ++i) {
+    buf[i] = char(v & 0xff);
+    v >>= 8;
+  }
+  out_.write(buf, n);
+}
+
+void checkpoint_out::str(const std::string& s) {
+  u32(uint32_t(s.size()));
+  bytes(s.data(), s.size());
+}
+
+void checkpoint_out::bytes(const void* data, std::size_t n) {
+  out_.write(static_cast<const char*>(data), std::streamsize(n));
+}
+
+uint64_t checkpoint_in::get(int n) {
+  unsigned char buf[8];
+  bytes(buf, std::size_t(n));
+  uint64_t v = 0;
+  for (int i = n - 1; i >= 0; --i) {
+    v = (v << 8) | buf[i];
+  }
+  return v;
+}
+
+std::string checkpoint_in::str() {
+  std::string s(u32(), '\0');
+  bytes(&s[0], s.size());
+  return s;
+}
+
+void checkpoint_in::bytes(void* data, std::size_t n) {
+  if (!in_.read(static_cast<char*>(data), std::streamsize(n))) {
+    throw std::runtime_error("checkpoint ends early");
+  }
+}
+
+void checkpoint_header::write(checkpoint_out& out) const {
+  out.bytes("CRCK", 4);
+  out.u8(version);
+  out.u16(unsigned(width));
+  out.u16(unsigned(height));
+  out.u64(tick);
+}
+
+checkpoint_header checkpoint_header::read(checkpoint_in& in) {
+  char magic[4];
+  in.bytes(magic, sizeof(magic));
+  if (std::memcmp(magic, "CRCK", sizeof(magic)) != 0) {
+    throw std::runtime_error("not a checkpoint");
+  }
+  if (auto v = in.u8(); v != version) {
+    throw std::runtime_error("unknown checkpoint version " + std::to_string(v));
+  }
+  checkpoint_header h;
+  h.width = int(in.u16());
+  h.height = int(in.u16());
+  h.tick = in.u64();
+  return h;
+}
+
+checkpointer::checkpointer(const std::string& dir, unsigned keep)
+  : dir_(dir)
+  , keep_(std::max(1u, keep))
+{
+  if (::mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST) {
+    throw std::system_error(errno, std::generic_category(), dir);
+  }
+  kept_ = scan(dir);
+}
+
+bool checkpointer::capture(unsigned long tick, const std::function<void(std::ostream&)>& write) {
+  reap(false);
+  if (child_ > 0) {
+    ++skipped_;
+    return false;
+  }
+
+  auto path = name(dir_, tick);
+  auto temp = dir_ + "/." + prefix + std::to_string(tick) + ".tmp";
+  // the other threads may hold the heap or locale locks at the fork, which the child would
+  // never get back, so everything that allocates happens here, before it
+  std::ostringstream out(std::ios::binary);
+  write(out);
+  const auto image = out.str();
+  std::cout.flush();
+  std::cerr.flush();
+  auto pid = ::fork();
+  if (pid < 0) {
+    ++skipped_;
+    return false;
+  }
+  if (pid == 0) {
+    // the child: only system calls from here on.
+    // Write, sync, and rename into place, so a checkpoint is never seen half written.
+    // _exit skips the parent's exit handlers, which would otherwise restore the terminal
+    int status = 1;
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd >= 0) {
+      const char* next = image.data();
+      auto left = image.size();
+      while (left > 0) {
+        auto n = ::write(fd, next, left);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        next += n;
+        left -= std::size_t(n);
+      }
+      if (left == 0 && ::fsync(fd) == 0) status = 0;
+      if (::close(fd) != 0) status = 1;
+    }
+    if (status == 0 && ::rename(temp.c_str(), path.c_str()) != 0) status = 1;
+    if (status != 0) ::unlink(temp.c_str());
+    ::_exit(status);
+  }
+  child_ = pid;
+  child_tick_ = tick;
+  return true;
+}
+
+void checkpointer::reap(bool block) {
+  if (child_ <= 0) return;
+  int status = 0;
+  auto done = ::waitpid(child_, &status, block? 0: WNOHANG);
+  if (done == 0) return;
+  child_ = -1;
+  if (done < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    ++failed_;
+    return;
+  }
+  ++written_;
+  kept_.push_back(child_tick_);
+  while (kept_.size() > keep_) {
+    std::remove(name(dir_, kept_.front()).c_str());
+    kept_.erase(kept_.begin());
+  }
+}
+
+void checkpointer::finish() {
+  reap(true);
+  if (reported_ || written_ + skipped_ + failed_ == 0) return;
+  reported_ = true;
+  std::cerr << "Wrote " << written_ << " checkpoints to " << dir_
+            << ", skipped " << skipped_ << ", failed " << failed_ << ".\n";
+}
+
+std::string checkpointer::latest(const std::string& dir) {
+  auto ticks = scan(dir);
+  return ticks.empty()? std::string(): name(dir, ticks.back());
+}
+
+std::string checkpointer::name(const std::string& dir, unsigned long tick) {
+  char digits[32];
+  std::snprintf(digits, sizeof(digits), "%012lu", tick);
+  return dir + '/' + prefix + digits + suffix;
+}
+
+std::vector<unsigned long> checkpointer::scan(const std::string& dir) {
+  std::vector<unsigned long> ticks;
+  auto* d = ::opendir(dir.c_str());
+  if (d == nullptr) {
+    if (errno == ENOENT) return ticks;
+    throw std::system_error(errno, std::generic_category(), dir);
+  }
+  while (auto* entry = ::readdir(d)) {
+    std::string file = entry->d_name;
+    if (file.size() <= prefix.size() + suffix.size() ||
+        file.compare(0, prefix.size(), prefix) != 0 ||
+        file.compare(file.size() - suffix.size(), suffix.size(), suffix) != 0) {
+      continue;
+    }
+    auto digits = file.substr(prefix.size(), file.size() - prefix.size() - suffix.size());
+    if (digits.find_first_not_of("0123456789") != std::string::npos) continue;
+    ticks.push_back(std::stoul(digits));
+  }
+  ::closedir(d);
+  std::sort(ticks.begin(), ticks.end());
+  return ticks;
+}
@@ -0,0 +1,173 @@
+#ifndef MESA_CRITTERS_CHECKPOINT_H
+#define MESA_CRITTERS_CHECKPOINT_H
+
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+/**
+ * Writes the fixed-size values of a checkpoint, little endian.
+ */
+class checkpoint_out {
+  public:
+    /**
+     * Write to a stream.
+     * @param out the stream, which must outlive this object
+     */
+    explicit checkpoint_out(std::ostream& out) : out_(out) {}
+
+    void u8(unsigned v)           { put(v, 1); }   /**< write one byte */
+    void u16(unsigned v)          { put(v, 2); }   /**< write two bytes */
+    void u32(uint32_t v)          { put(v, 4); }   /**< write four bytes */
+    void u64(uint64_t v)          { put(v, 8); }   /**< write eight bytes */
+    /**
+     * Write a string as a u32 length, then its bytes.
+     */
+    void str(const std::string& s);
+    /**
+     * Write raw bytes.
+     */
+    void bytes(const void* data, std::size_t n);
+
+  private:
+    std::ostream& out_;           /**< where values are written */
+    /**
+     * Write the low n bytes of v.
+     */
+    void put(uint64_t v, int n);
+};
+
+/**
+ * Reads the values written by checkpoint_out.
+ * Every read throws std::runtime_error if the input ends early.
+ */
+class checkpoint_in {
+  public:
+    /**
+     * Read from a stream.
+     * @param in the stream, which must outlive this object
+     */
+    explicit checkpoint_in(std::istream& in) : in_(in) {}
+
+    unsigned u8()                 { return unsigned(get(1)); }   /**< read one byte */
+    unsigned u16()                { return unsigned(get(2)); }   /**< read two bytes */
+    uint32_t u32()                { return uint32_t(get(4)); }   /**< read four bytes */
+    uint64_t u64()                { return get(8); }             /**< read eight bytes */
+    /**
+     * Read a string written by checkpoint_out::str().
+     */
+    std::string str();
+    /**
+     * Read raw bytes.
+     */
+    void bytes(void* data, std::size_t n);
+
+  private:
+    std::istream& in_;            /**< where values are read from */
+    /**
+     * Read an n byte value.
+     */
+    uint64_t get(int n);
+};
+
+/**
+ * The start of every checkpoint: "CRCK", a u8 version, the world size and the tick.
+ */
+struct checkpoint_header {
+  static constexpr unsigned version = 1;  /**< the version written */
+
+  int width = 0;              /**< width of the world */
+  int height = 0;             /**< height of the world */
+  unsigned long tick = 0;     /**< the tick the checkpoint was taken after */
+
+  /**
+   * Write the header.
+   */
+  void write(checkpoint_out& out) const;
+  /**
+   * Read a header.
+   * @throws std::runtime_error if this is not a checkpoint of a known version
+   */
+  static checkpoint_header read(checkpoint_in& in);
+};
+
+/**
+ * Keeps a directory of rotating checkpoints, written in the background.
+ *
+ * A checkpoint is serialized into memory, then written out by a forked child,
+ * which writes it to a temporary file, syncs it, renames it into place and exits
+ * while the parent carries on with the next tick.  The simulation stalls only
+ * to serialize the world and fork, not for the disk.
+ * Other threads may be running at the fork, holding locks the child would never
+ * get back, so the child makes nothing but system calls.
+ * If the previous checkpoint is still being written when the next one is due,
+ * the next one is skipped rather than letting children pile up.
+ *
+ * Checkpoints are named checkpoint-<tick>.crck, with the tick zero padded,
+ * and only the newest few are kept.
+ */
+class checkpointer {
+  public:
+    /**
+     * Keep checkpoints in a directory.
+     * Checkpoints already in the directory count toward the number kept.
+     * @param dir the directory, which is created if needed
+     * @param keep the number of checkpoints to keep, at least 1
+     * @throws std::system_error if the directory can't be created or read
+     */
+    checkpointer(const std::string& dir, unsigned keep);
+    /**
+     * Wait for the checkpoint being written, if any.
+     */
+    ~checkpointer() { finish(); }
+
+    /**
+     * Start writing a checkpoint in a child process.
+     * @param tick the tick of the checkpoint
+     * @param write called to serialize the checkpoint, before the fork
+     * @return false if the checkpoint was skipped, because the previous one
+     *         is still being written or the fork failed
+     */
+    bool capture(unsigned long tick, const std::function<void(std::ostream&)>& write);
+    /**
+     * Wait for the checkpoint being written, if any, and report what was written.
+     */
+    void finish();
+
+    /**
+     * Find the newest checkpoint in a directory.
+     * @return its path, or an empty string if there is none
+     */
+    static std::string latest(const std::string& dir);
+
+  private:
+    std::string dir_;                   /**< where checkpoints are kept */
+    unsigned keep_;                     /**< checkpoints to keep */
+    std::vector<unsigned long> kept_;   /**< ticks of the checkpoints on disk, oldest first */
+    pid_t child_ = -1;                  /**< the child writing a checkpoint, if any */
+    unsigned long child_tick_ = 0;      /**< the tick that child is writing */
+    unsigned long written_ = 0;         /**< checkpoints written */
+    unsigned long skipped_ = 0;         /**< checkpoints skipped */
+    unsigned long failed_ = 0;          /**< checkpoints the child failed to write */
+    bool reported_ = false;             /**< true once finish() has reported */
+
+    /**
+     * Collect the child, if it has finished.
+     * @param block true to wait for it
+     */
+    void reap(bool block);
+    /**
+     * @return the path of the checkpoint for a tick
+     */
+    static std::string name(const std::string& dir, unsigned long tick);
+    /**
+     * @return the ticks of the checkpoints in a directory, oldest first
+     */
+    static std::vector<unsigned long> scan(const std::string& dir);
+};
+
+#endif
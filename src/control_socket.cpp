@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <system_error>
+#include <utility>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "control_socket.h"
+
+double metrics::tick_seconds(double q) const {
+  auto total = tick_count();
+  if (total == 0) return 0;
+  // the rank of the quantile, counting from 1
+  auto want = std::max(uint64_t(1), uint64_t(std::ceil(q * double(total))));
+  uint64_t seen = 0;
+  for (std::size_t i = 0; i < buckets; ++i) {
+    seen += tick_ns[i];
+    if (seen >= want) {
+      return double(uint64_t(1) << (i + 1)) * 1e-9;
+    }
+  }
+  return double(uint64_t(1) << buckets) * 1e-9;
+}
+
+uint64_t metrics::tick_count() const {
+  uint64_t total = 0;
+  for (auto n: tick_ns) total += n;
+  return total;
+}
+
+control_socket::control_socket(const std::string& path)
+  : path_(path)
+{
+  sockaddr_un addr {};
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    throw std::system_error(ENAMETOOLONG, std::generic_category(), path);
+  }
+  std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+  listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) {
+    throw std::system_error(errno, std::generic_category(), "socket");
+  }
+  unlink(path.c_str());
+  if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      listen(listen_fd_, 4) != 0) {
+    auto err = errno;
+    close(listen_fd_);
+    throw std::system_error(err, std::generic_category(), path);
+  }
+  server_ = std::thread(&control_socket::serve, this);
+}
+
+control_socket::~control_socket() {
+  running_ = false;
+  if (server_.joinable()) server_.join();
+  close(listen_fd_);
+  unlink(path_.c_str());
+}
+
+void control_socket::publish(metrics& m) {
+  std::unique_lock<std::mutex> lock(snapshot_lock_, std::try_to_lock);
+  if (lock.owns_lock()) {
+    std::swap(snapshot_, m);
+  }
+}
+
+void control_socket::serve() {
+  struct client {
+    int fd;
+    std::string pending;
+  };
+  std::vector<client> clients;
+  std::vector<pollfd> fds;
+
+  while (running_) {
+    fds.assign(1, pollfd{listen_fd_, POLLIN, 0});
+    for (const auto& c: clients) {
+      fds.push_back(pollfd{c.fd, POLLIN, 0});
+    }
+    // wake up regularly to notice running_ being cleared
+    if (::poll(fds.data(), fds.size(), 100) <= 0) continue;
+
+    if (fds[0].revents & POLLIN) {
+      if (int fd = accept(listen_fd_, nullptr, nullptr); fd >= 0) {
+        clients.push_back(client{fd, {}});
+      }
+    }
+    for (std::size_t i = 1; i < fds.size(); ++i) {
+      if (fds[i].revents == 0) continue;
+      auto& c = clients[i - 1];
+      char buf[256];
+      auto n = read(c.fd, buf, sizeof(buf));
+      if (n <= 0) {
+        close(c.fd);
+        c.fd = -1;
+        continue;
+      }
+      c.pending.append(buf, std::size_t(n));
+      for (auto eol = c.pending.find('\n'); eol != std::string::npos; eol = c.pending.find('\n')) {
+        auto line = c.pending.substr(0, eol);
+        c.pending.erase(0, eol + 1);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        auto reply = answer(line);
+        // MSG_NOSIGNAL: a client that has hung up is closed, not a SIGPIPE for the game
+        if (send(c.fd, reply.data(), reply.size(), MSG_NOSIGNAL) < 0) {
+          close(c.fd);
+          c.fd = -1;
+          break;
+        }
+      }
+    }
+    clients.erase(std::remove_if(clients.begin(), clients.end(),
+          [](const client& c) { return c.fd < 0; }), clients.end());
+  }
+  for (const auto& c: clients) {
+    close(c.fd);
+  }
+}
+
+std::string control_socket::answer(const std::string& line) {
+  char key = 0;
+  if      (line == "p" || line == "pause")  key = 'p';
+  else if (line == "+" || line == "faster") key = '+';
+  else if (line == "-" || line == "slower") key = '-';
+  else if (line == "q" || line == "quit")   key = 'q';
+  else if (line == "e" || line == "export") key = 'e';
+  if (key != 0) {
+    command_ = key;
+    return "ok\n";
+  }
+
+  if (line == "metrics" || line == "stats") {
+    metrics m;
+    {
+      std::lock_guard<std::mutex> lock(snapshot_lock_);
+      m = snapshot_;
+    }
+    return line == "metrics"? prometheus(m): stats(m);
+  }
+  return "error: unknown command '" + line + "'\n";
+}
+
+std::string control_socket::prometheus(const metrics& m) {
+  std::ostringstream os;
+  os << "# HELP critters_tick Current simulation tick.\n"
+     << "# TYPE critters_tick counter\n"
+     << "critters_tick " << m.tick << '\n'
+     << "# HELP critters_ticks_per_second Tick rate over the last second.\n"
+     << "# TYPE critters_ticks_per_second gauge\n"
+     << "critters_ticks_per_second " << m.ticks_per_second << '\n'
+     << "# HELP critters_paused 1 if the simulation is paused.\n"
+     << "# TYPE critters_paused gauge\n"
+     << "critters_paused " << (m.paused? 1: 0) << '\n'
+     << "# HELP critters_tick_seconds Time taken to compute a tick.\n"
+     << "# TYPE critters_tick_seconds summary\n";
+  for (auto q: {0.5, 0.9, 0.99, 1.0}) {
+    os << "critters_tick_seconds{quantile=\"" << q << "\"} " << m.tick_seconds(q) << '\n';
+  }
+  os << "critters_tick_seconds_count " << m.tick_count() << '\n';
+
+  auto family = [&os, &m](const char* name, const char* help, auto value) {
+    os << "# HELP critters_species_" << name << ' ' << help << '\n'
+       << "# TYPE critters_species_" << name << " gauge\n";
+    for (const auto& s: m.species) {
+      os << "critters_species_" << name << "{species=\"" << s.name << "\"} " << value(s) << '\n';
+    }
+  };
+  family("alive",    "Living members of a species.",      [](const species_metrics& s) { return s.alive; });
+  family("dead",     "Dead members of a species.",        [](const species_metrics& s) { return s.dead; });
+  family("kills",    "Kills made by a species.",          [](const species_metrics& s) { return s.kills; });
+  family("feedings", "Food eaten by a species.",          [](const species_metrics& s) { return s.feedings; });
+  family("starved",  "Members of a species that starved.", [](const species_metrics& s) { return s.starved; });
+  family("score",    "Score of a species.",               [](const species_metrics& s) { return s.score; });
+  return os.str();
+}
+
+std::string control_socket::stats(const metrics& m) {
+  std::ostringstream os;
+  os << "tick " << m.tick << '\n'
+     << "ticks_per_second " << m.ticks_per_second << '\n'
+     << "paused " << (m.paused? 1: 0) << '\n'
+     << "tick_seconds_p50 " << m.tick_seconds(0.5) << '\n'
+     << "tick_seconds_p90 " << m.tick_seconds(0.9) << '\n'
+     << "tick_seconds_p99 " << m.tick_seconds(0.99) << '\n'
+     << "tick_seconds_max " << m.tick_seconds(1.0) << '\n';
+  for (const auto& s: m.species) {
+    os << "species " << s.name
+       << " alive " << s.alive
+       << " dead " << s.dead
+       << " kills " << s.kills
+       << " feedings " << s.feedings
+       << " starved " << s.starved
+       << " score " << s.score << '\n';
+  }
+  os << '\n';
+  return os.str();
+}
+
@@ -0,0 +1,129 @@
+#ifndef MESA_CRITTERS_CONTROL_SOCKET_H
+#define MESA_CRITTERS_CONTROL_SOCKET_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Counters for one species, copied out of the simulation once per tick.
+ */
+struct species_metrics {
+  std::string name;           /**< name of the species */
+  unsigned int alive = 0;     /**< @see species::alive */
+  unsigned int dead = 0;      /**< @see species::dead */
+  unsigned int kills = 0;     /**< @see species::kills */
+  unsigned int feedings = 0;  /**< @see species::feedings */
+  unsigned int starved = 0;   /**< @see species::starved */
+  unsigned int score = 0;     /**< @see species::score */
+};
+
+/**
+ * The state of the simulation at the end of a tick, as served by control_socket.
+ */
+struct metrics {
+  /**
+   * Tick durations are counted in buckets by the position of their highest set bit,
+   * in nanoseconds.  Bucket i holds durations in [2^i, 2^(i+1)).
+   */
+  static constexpr std::size_t buckets = 40;
+
+  unsigned long tick = 0;                         /**< the current tick */
+  double ticks_per_second = 0;                    /**< tick rate over the last second */
+  bool paused = false;                            /**< true if the simulation is paused */
+  std::array<uint64_t, buckets> tick_ns {};       /**< histogram of tick durations */
+  std::vector<species_metrics> species;           /**< counters of every species */
+
+  /**
+   * Estimate a tick duration percentile from the histogram.
+   * @param q the quantile, between 0 and 1
+   * @return the upper bound of the bucket holding the quantile, in seconds
+   */
+  double tick_seconds(double q) const;
+  /**
+   * @return the number of ticks recorded in the histogram
+   */
+  uint64_t tick_count() const;
+};
+
+/**
+ * Serves metrics and accepts control commands on a local Unix domain socket.
+ *
+ * Clients send one command per line and get a reply to each:
+ *  - metrics:  all metrics in the Prometheus text format
+ *  - stats:    all metrics, one per line
+ *  - p, pause: toggle between play and pause, as the 'p' key does
+ *  - +, faster: speed up the simulation, as the '+' key does
+ *  - -, slower: slow down the simulation, as the '-' key does
+ *  - q, quit:  stop the simulation, as the 'q' key does
+ *  - e, export: write the recorded species counters, as the 'e' key does
+ *
+ * The socket is served by its own thread.
+ * The simulation hands over a snapshot after each tick without ever waiting on
+ * that thread, and collects commands with a single atomic exchange.
+ */
+class control_socket {
+  public:
+    /**
+     * Create a socket and start serving it.
+     * Any file already at path is replaced.
+     * @param path the filesystem path of the socket
+     * @throws std::system_error if the socket can't be created
+     */
+    explicit control_socket(const std::string& path);
+    /**
+     * Stop serving and remove the socket.
+     */
+    ~control_socket();
+
+    control_socket(const control_socket&) = delete;
+    control_socket& operator=(const control_socket&) = delete;
+
+    /**
+     * Offer the latest metrics to the server.
+     * Never blocks: if the server is busy reading the previous snapshot,
+     * this one is dropped and the next one is used instead.
+     * @param m the metrics to publish.  Swapped with the previous snapshot.
+     */
+    void publish(metrics& m);
+
+    /**
+     * Collect the command most recently received, if any.
+     * @return the key equivalent to the command, or 0 if there is none
+     */
+    char poll() { return command_.exchange(0); }
+
+  private:
+    std::string path_;                  /**< filesystem path of the socket */
+    int listen_fd_ = -1;                /**< the listening socket */
+    std::atomic<bool> running_ {true};  /**< cleared to stop the server thread */
+    std::atomic<char> command_ {0};     /**< the latest unclaimed command */
+    std::mutex snapshot_lock_;          /**< guards snapshot_ */
+    metrics snapshot_;                  /**< the latest published metrics */
+    std::thread server_;                /**< serves the socket */
+
+    /**
+     * Accept clients and answer their commands until running_ is cleared.
+     */
+    void serve();
+    /**
+     * Answer one command.
+     * @param line the command, without its newline
+     * @return the reply
+     */
+    std::string answer(const std::string& line);
+    /**
+     * Format a snapshot in the Prometheus text format.
+     */
+    static std::string prometheus(const metrics& m);
+    /**
+     * Format a snapshot one metric per line.
+     */
+    static std::string stats(const metrics& m);
+};
+
+#endif
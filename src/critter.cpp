@@ -1,8 +1,15 @@
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 
 #include "critter.h"
 
+void critter::move_batch(const neighborhood* views, direction* moves, std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    moves[i] = views[i].self->survey(views[i].to_map(), views[i].sight);
+  }
+}
+
 void critter::start_mating(int rest) {
   assert(!mating_ && awake_);
   mating_ = true;
@@ -41,6 +48,14 @@ void critter::tick() {
   }
 }
 
+void critter::tick(int turns) {
+  assert(turns >= 0 && turns <= wait_time_ && turns < food_remaining_);
+  assert(!awake_ || mating_);
+  food_remaining_ -= turns;
+  baby_timer_ = std::max(0, baby_timer_ - turns);
+  wait_time_ -= turns;
+}
+
 const std::array<critter::attack, 4> critter::attacks = {
   {
       critter::attack::ROAR,
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "flow_fields.h"
+
+void flow_fields::reset(const world_geometry* geom, const occupancy* occ) {
+  assert (geom != nullptr && occ != nullptr);
+  assert (reach_ > 0 && reach_ < unreachable);
+  geom_ = geom;
+  occ_ = occ;
+  fields_.clear();
+  buckets_.assign(reach_ + 1, {});
+  stamp_.assign(geom_->size(), 0);
+  epoch_ = 0;
+}
+
+const flow_fields::field* flow_fields::current(occupancy::kind target) const {
+  if (target == occupancy::EMPTY || target == occupancy::STONE || target >= occ_->kinds()) {
+    return nullptr;
+  }
+  if (target >= fields_.size()) fields_.resize(target + 1);
+  auto& f = fields_[target];
+  if (f.version == occ_->version()) return &f;
+  // versions start at 1, so a field never built is never repaired
+  if (f.version == 0 || !repair(target, f)) {
+    rebuild(target, f);
+  }
+  f.version = occ_->version();
+  return &f;
+}
+
+void flow_fields::rebuild(occupancy::kind target, field& f) const {
+  f.dist.assign(geom_->size(), unreachable);
+  occ_->for_each(target, [&f, this](std::size_t p) {
+    f.dist[p] = 0;
+    buckets_[0].push_back(p);
+  });
+  spread(f);
+}
+
+bool flow_fields::repair(occupancy::kind target, field& f) const {
+  next_epoch();
+  cleared_.clear();
+  // a tile that holds a target now is one; one that held a target, or has
+  // become a stone, takes down every tile measured through it
+  auto fine = occ_->changes_since(f.version, [&f, target, this](std::size_t p) {
+    auto k = occ_->at(p);
+    if (k == target) {
+      if (f.dist[p] != 0) {
+        f.dist[p] = 0;
+        buckets_[0].push_back(p);
+      }
+    } else if (f.dist[p] == 0 || (k == occupancy::STONE && f.dist[p] != unreachable)) {
+      clear(f, p);
+    } else if (k != occupancy::STONE) {
+      // it may have been a stone, and can be walked through now
+      cleared_.emplace_back(p, f.dist[p]);
+    }
+  });
+  if (!fine) return false;
+
+  // fill the cleared tiles back in from the tiles around them
+  for (const auto& c: cleared_) {
+    for (const auto& dir: directions) {
+      auto n = geom_->translate(c.first, dir);
+      if (f.dist[n] < reach_) buckets_[f.dist[n]].push_back(n);
+    }
+  }
+  spread(f);
+  return true;
+}
+
+void flow_fields::clear(field& f, std::size_t p) const {
+  if (stamp_[p] == epoch_) return;
+  // a tile can only have been measured through p if it is one further out
+  auto first = cleared_.size();
+  stamp_[p] = epoch_;
+  cleared_.emplace_back(p, f.dist[p]);
+  f.dist[p] = unreachable;
+  for (auto i = first; i < cleared_.size(); ++i) {
+    auto [here, was] = cleared_[i];
+    for (const auto& dir: directions) {
+      auto n = geom_->translate(here, dir);
+      if (stamp_[n] != epoch_ && f.dist[n] != unreachable && f.dist[n] == was + 1) {
+        stamp_[n] = epoch_;
+        cleared_.emplace_back(n, f.dist[n]);
+        f.dist[n] = unreachable;
+      }
+    }
+  }
+}
+
+void flow_fields::spread(field& f) const {
+  // breadth first, one distance at a time, from every tile in the buckets at once
+  for (int d = 0; d <= reach_; ++d) {
+    auto& bucket = buckets_[d];
+    for (std::size_t i = 0; i < bucket.size() && d < reach_; ++i) {
+      auto here = bucket[i];
+      if (f.dist[here] != d) continue;    // lowered since it was queued
+      for (const auto& dir: directions) {
+        auto n = geom_->translate(here, dir);
+        if (d + 1 < f.dist[n] && occ_->at(n) != occupancy::STONE) {
+          f.dist[n] = uint8_t(d + 1);
+          buckets_[d + 1].push_back(n);
+        }
+      }
+    }
+    bucket.clear();
+  }
+}
+
+void flow_fields::next_epoch() const {
+  if (++epoch_ == 0) {
+    std::fill(stamp_.begin(), stamp_.end(), 0);
+    epoch_ = 1;
+  }
+}
+
+uint8_t flow_fields::distance(occupancy::kind target, std::size_t p) const {
+  auto f = current(target);
+  return f == nullptr? unreachable: f->dist[p];
+}
+
+direction flow_fields::toward(occupancy::kind target, std::size_t p) const {
+  auto f = current(target);
+  if (f == nullptr) return direction::CENTER;
+  auto best = direction::CENTER;
+  auto best_dist = unreachable;
+  for (const auto& d: directions) {
+    if (auto n = f->dist[geom_->translate(p, d)]; n < best_dist) {
+      best = d;
+      best_dist = n;
+    }
+  }
+  return best;
+}
+
+direction flow_fields::away_from(occupancy::kind target, std::size_t p) const {
+  auto f = current(target);
+  if (f == nullptr) return direction::CENTER;
+  if (f->dist[p] == unreachable) return direction::CENTER;
+  auto best = direction::CENTER;
+  auto best_dist = f->dist[p];
+  for (const auto& d: directions) {
+    auto n = geom_->translate(p, d);
+    if (occ_->at(n) != occupancy::STONE && f->dist[n] > best_dist) {
+      best = d;
+      best_dist = f->dist[n];
+    }
+  }
+  return best;
+}
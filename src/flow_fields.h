@@ -0,0 +1,127 @@
+#ifndef MESA_CRITTERS_FLOW_FIELDS_H
+#define MESA_CRITTERS_FLOW_FIELDS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "direction.h"
+#include "geometry.h"
+#include "occupancy.h"
+
+/**
+ * Distance fields toward every kind of target in the world: food and each species.
+ *
+ * Each field holds, for every tile, the number of moves needed to reach the
+ * nearest target of its kind, walking around stones.
+ * Distances are only tracked out to a fixed reach; anything further away is unreachable.
+ *
+ * Fields are built lazily and kept current incrementally.
+ * Nothing is computed until a field is first asked about; it is then built
+ * in one breadth first pass.  After that, each time it is asked about, it
+ * catches up with the tiles occupancy says have changed since, and only the
+ * tiles whose distance those changes can affect are touched:
+ * a new target or a cleared stone relaxes the tiles it brings closer,
+ * and a lost target or a new stone clears the tiles that were measured
+ * through it, which are then filled in again from the tiles around them.
+ * A field nobody asks about costs nothing.
+ */
+class flow_fields {
+  public:
+    /**
+     * Distance reported for tiles further than reach() from any target.
+     */
+    static constexpr uint8_t unreachable = 255;
+
+    /**
+     * Create an empty set of fields.
+     * @param reach the largest distance tracked.  Must be less than 255.
+     */
+    explicit flow_fields(int reach = unreachable - 1) : reach_(reach) {}
+
+    /**
+     * Discard all fields and start over on a new world.
+     * @param geom the geometry of the world.  Must outlive this object.
+     * @param occ what occupies each tile.  Must outlive this object.
+     */
+    void reset(const world_geometry* geom, const occupancy* occ);
+
+    /**
+     * @return the largest distance tracked
+     */
+    int reach() const { return reach_; }
+
+    /**
+     * Get the distance from a tile to the nearest target.
+     * @param target occupancy::FOOD or a species
+     * @param p the slot of the tile
+     * @return the distance, or unreachable
+     */
+    uint8_t distance(occupancy::kind target, std::size_t p) const;
+
+    /**
+     * Find the first step on a shortest path toward the nearest target.
+     * @param target occupancy::FOOD or a species
+     * @param p the slot of the starting tile
+     * @return the direction to move, or CENTER if no target is in range
+     */
+    direction toward(occupancy::kind target, std::size_t p) const;
+    /**
+     * Find the step that moves furthest from the nearest target.
+     * @param target occupancy::FOOD or a species
+     * @param p the slot of the starting tile
+     * @return the direction to move, or CENTER if no target is in range
+     *         or no step gets further away
+     */
+    direction away_from(occupancy::kind target, std::size_t p) const;
+
+  private:
+    /**
+     * The distances toward one kind of target.
+     */
+    struct field {
+      std::vector<uint8_t> dist;     /**< moves to the nearest target, per slot */
+      uint64_t version = 0;          /**< occupancy::version() dist is current with; 0 if never built */
+    };
+
+    int reach_;                                     /**< largest distance tracked */
+    const world_geometry* geom_ = nullptr;          /**< geometry of the world */
+    const occupancy* occ_ = nullptr;                /**< what occupies each tile */
+    mutable std::vector<field> fields_;             /**< one field per kind; empty until first asked about */
+
+    // scratch space for updates, reused between them
+    mutable std::vector<std::vector<std::size_t>> buckets_;  /**< slots to spread from, by distance */
+    mutable std::vector<std::pair<std::size_t, uint8_t>> cleared_;  /**< slots cleared, with their old distance */
+    mutable std::vector<uint32_t> stamp_;           /**< epoch_ for slots cleared or seen in this update */
+    mutable uint32_t epoch_ = 0;                    /**< the mark of this update */
+
+    /**
+     * Find the field for a kind, bringing it up to date with the world.
+     * @return the field, or nullptr if the kind is not a target
+     */
+    const field* current(occupancy::kind target) const;
+    /**
+     * Recompute the distances of every tile of a field from scratch.
+     */
+    void rebuild(occupancy::kind target, field& f) const;
+    /**
+     * Repair the distances of a field around the tiles changed since it was current.
+     * @return false if occupancy no longer remembers those changes
+     */
+    bool repair(occupancy::kind target, field& f) const;
+    /**
+     * Clear a tile, and every tile measured through it, to unreachable.
+     */
+    void clear(field& f, std::size_t p) const;
+    /**
+     * Spread distances out from the buckets, lowering any that are too high.
+     */
+    void spread(field& f) const;
+    /**
+     * Start a new update, so stamps from earlier ones don't count.
+     */
+    void next_epoch() const;
+};
+
+#endif
@@ -3,181 +3,752 @@
 #include <cstdint>
 #include <chrono>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <random>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
 #include <thread>
 #include <utility>
 #include <unistd.h>
 
+#include "allocations.h"
 #include "game.h"
-#include "food.h"
+#include "logger.h"
+#include "remote_species.h"
+#include "tracer.h"
 #include "view.h"
 #include "view_curses.h"
 
 using std::this_thread::sleep_for;
 using std::shared_ptr;
 
-// a single location in the critters world
-using tile = std::pair<point,  std::shared_ptr<critter>>;
-
-namespace {
-  std::random_device r;
-  std::default_random_engine gen(r());
-} // end anonymous namespace
-
 void game::set_debug(int debug_level) {
   debug_ = debug_level;
 }
+void game::set_seed(uint64_t seed) {
+  seed_ = seed;
+  gen_.seed(seed);
+}
+
 void game::set_view(std::unique_ptr<view> v) {
   assert (v != nullptr);
   view_ = std::move(v);
   init_tiles();
 }
 
+void game::set_control(std::unique_ptr<control_socket> c) {
+  control_ = std::move(c);
+}
+
+void game::set_shared(const std::string& name) {
+  try {
+    shared_ = std::make_unique<shared_world>(name, geom_.width(), geom_.height());
+  } catch (const std::system_error&) {
+    view_->teardown();
+    throw;
+  }
+  geom_.for_each([this](std::size_t p) { share(p); });
+  shared_->publish(tick_, prototypes_, players_);
+}
+
+void game::isolate(std::vector<std::pair<std::shared_ptr<critter>, int>>& players) {
+  std::vector<std::shared_ptr<critter>> prototypes;
+  for (const auto& p : players) {
+    prototypes.push_back(p.first);
+  }
+  auto stand_ins = remote_species::isolate(prototypes, tick_);
+  for (std::size_t i = 0; i < players.size(); ++i) {
+    players[i].first = stand_ins[i];
+  }
+}
+
+void game::set_checkpoints(std::unique_ptr<checkpointer> c, unsigned long every) {
+  checkpoints_ = std::move(c);
+  checkpoint_every_ = std::max(1ul, every);
+  next_checkpoint_ = (tick_ / checkpoint_every_ + 1) * checkpoint_every_;
+}
+
+void game::set_recorder(std::unique_ptr<recorder> r) {
+  recorder_ = std::move(r);
+}
+
 void game::start() {
   bool play = false;
   bool help = false;
   int delay = 1000;
   int count = 0;
 
-  view_->redraw(tiles_);
   view_->update_score(players_);
+  view_->redraw();
+  report(!play);
+  if (recorder_) recorder_->track(players_, tick_);
+  history_ = std::make_unique<history>(history_budget);
+  history_->reset(geom_.size(), tick_, players_);
+  geom_.for_each([this](std::size_t p) { history_->prime(p, *tile(p)); });
+  count_allocations();
 
   while (command_ != 'q')
   {
     command_ = view_->get_key();
+    if (control_) {
+      if (auto c = control_->poll(); c != 0) command_ = c;
+    }
 
     if (command_ == 'h') {
       if (help) { view_->hide_help(); }  // hide only if already being shown
       help = !help;
     }
     if (help)                               { view_->show_help(); }
-    if (command_ == 'p')                    { play = !play; }
+    if (command_ == 'p')                    { play = !play; report(!play); }
+    if (command_ == 'e')                    { export_series(); }
     if (command_ == '-')                    { delay = std::min(25000, delay + 100); }
     if (command_ == '=' || command_ == '+') { delay = std::max(  10, delay - 100); }
+    if (command_ == ',' || command_ == '<') {
+      if (play) { play = false; report(!play); }
+      rewind(command_ == ','? -1: -50);
+    }
+    if (command_ == '>')                    { rewind(50); }
+    if (command_ == '.') {
+      // step forward through the history, or play one tick when there is none to replay
+      if (history_->rewound())              { rewind(1); }
+      else if (!play)                       { step(); checkpoint(); report(!play); }
+    }
     sleep_for(std::chrono::microseconds(100));
 
     if (play && count > delay) {
       count = 0;
-      ++tick_;
-      update_tiles();
-      view_->update_time(tick_);
-      view_->update_score(players_);
+      // catch up with the latest tick before playing on
+      if (history_->rewound()) rewind(std::numeric_limits<long>::max());
       // one species left standing
-      if (auto alone = [this]() {
-            auto count = 0;
-            for (const auto& p : players_) {
-              if (p.second->alive() > 0) ++count;
-            }
-            return count <= 1;
-          }; alone()) {
+      if (!step()) {
         play = false;
       }
+      checkpoint();
+      report(!play);
     }
     ++count;
   }
   view_->teardown();
+  history_.reset();
+  if (checkpoints_) checkpoints_->finish();
+  if (recorder_) recorder_->finish();
+  report_allocations();
+}
+
+void game::run(unsigned long ticks) {
+  play(ticks);
+  view_->teardown();
+  if (checkpoints_) checkpoints_->finish();
+  if (recorder_) recorder_->finish();
+
+  std::cout << "tick " << tick_ << '\n';
+  for (const auto& p : players_) {
+    std::cout << *p.second << '\n';
+  }
+  report_allocations();
+}
+
+void game::count_allocations() {
+  allocations_since_ = allocations_last_ = allocations::counts();
+  allocations_from_ = tick_;
+  allocations_worst_ = 0;
+  allocations_worst_tick_ = tick_;
+}
+
+void game::report_allocations() const {
+  if (!allocations::tracked) return;
+  allocations::summary(std::cerr, allocations_last_ - allocations_since_, tick_ - allocations_from_,
+                       allocations_worst_, allocations_worst_tick_);
+}
+
+void game::play(unsigned long ticks) {
+  bool playing = true;
+  int delay = 0;    // microseconds between ticks
+
+  count_allocations();
+  view_->redraw();
+  report(!playing);
+  if (recorder_) recorder_->track(players_, tick_);
+  while (command_ != 'q' && (ticks == 0 || tick_ < ticks)) {
+    command_ = control_? control_->poll(): 0;
+    if (command_ == 'p')                    { playing = !playing; report(!playing); }
+    if (command_ == 'e')                    { export_series(); }
+    if (command_ == '-')                    { delay = std::min(2500000, delay + 10000); }
+    if (command_ == '=' || command_ == '+') { delay = std::max(      0, delay - 10000); }
+
+    if (!playing) {
+      sleep_for(std::chrono::milliseconds(10));
+      continue;
+    }
+    // when nothing could move last tick, jump to the next tick where something can
+    if (movers_ == 0 && delay == 0) {
+      auto limit = ticks == 0? std::numeric_limits<unsigned long>::max(): ticks - tick_;
+      if (auto quiet = quiet_ticks(limit); quiet > 0) {
+        fast_forward(quiet);
+        checkpoint();
+        report(false);
+        continue;
+      }
+    }
+    auto more = step();
+    checkpoint();
+    report(false);
+    if (!more) break;
+    if (delay > 0) sleep_for(std::chrono::microseconds(delay));
+  }
+}
+
+void game::reset() {
+  command_ = 'x';
+  tick_ = 0;
+  movers_ = 0;
+  tick_ns_ = {};
+  rate_ticks_ = 0;
+  ticks_per_second_ = 0;
+  critters_.assign(geom_.size(), nullptr);
+  population_ = 0;
+  players_.clear();
+  prototypes_.clear();
+  occupancy_.reset(&geom_);
+  flows_.reset(&geom_, &occupancy_);
+  parked_ = bitboard(geom_.size());
+  naps_.clear();
+  wakeups_.reset(0);
+}
+
+bool game::step() {
+  using namespace std::chrono;
+  auto started = steady_clock::now();
+  ++tick_;
+  tracer::span traced("tick");
+  traced.arg("tick", tick_);
+  update_tiles();
+  if (history_) {
+    tracer::span span("history");
+    allocations::scope charged(allocations::HISTORY);
+    history_->commit(tick_, players_);
+  }
+  {
+    tracer::span span("view", "view");
+    allocations::scope charged(allocations::VIEW);
+    view_->update_time(tick_);
+    view_->update_score(players_);
+    view_->redraw();
+  }
+  if (recorder_) {
+    tracer::span span("record");
+    allocations::scope charged(allocations::RECORD);
+    recorder_->record(tick_);
+  }
+  auto finished = steady_clock::now();
+
+  if constexpr (allocations::tracked) {
+    // charged from the end of the last tick, so what play() does between ticks counts too
+    auto now = allocations::counts();
+    auto used = now - allocations_last_;
+    allocations_last_ = now;
+    uint64_t n = 0;
+    for (const auto& c : used) n += c.allocations;
+    if (n > allocations_worst_) {
+      allocations_worst_ = n;
+      allocations_worst_tick_ = tick_;
+    }
+  }
+
+  // bucket by the highest set bit of the duration in nanoseconds
+  auto ns = uint64_t(duration_cast<nanoseconds>(finished - started).count());
+  auto bucket = ns == 0? 0: std::size_t(63 - __builtin_clzll(ns));
+  ++tick_ns_[std::min(bucket, metrics::buckets - 1)];
+
+  if (rate_ticks_++ == 0) {
+    rate_since_ = started;
+  } else if (auto window = duration<double>(finished - rate_since_).count(); window >= 1.0) {
+    ticks_per_second_ = double(rate_ticks_) / window;
+    rate_ticks_ = 0;
+  }
+
+  auto alive = 0;
+  for (const auto& p : players_) {
+    if (p.second->alive() > 0) ++alive;
+  }
+  return alive > 1;
+}
+
+void game::checkpoint() {
+  if (!checkpoints_ || tick_ < next_checkpoint_) return;
+  tracer::span span("checkpoint");
+  allocations::scope charged(allocations::CHECKPOINT);
+  next_checkpoint_ = (tick_ / checkpoint_every_ + 1) * checkpoint_every_;
+  checkpoints_->capture(tick_, [this](std::ostream& out) { save(out); });
+}
+
+void game::rewind(long ticks) {
+  auto ghost = [this](std::size_t p, const history::look& l) {
+    view_->draw(geom_.to_point(p), history::ghost(l));
+  };
+  for (; ticks < 0 && history_->back(ghost); ++ticks) {}
+  for (; ticks > 0 && history_->forward(ghost); --ticks) {}
+  view_->update_time(history_->shown());
+  view_->update_score(history_->scores());
+  view_->redraw();
+}
+
+void game::export_series() {
+  if (!recorder_) return;
+  try {
+    recorder_->write();
+  } catch (const std::system_error&) {
+  }
+}
+
+void game::save(std::ostream& out) const {
+  checkpoint_out w(out);
+  checkpoint_header {geom_.width(), geom_.height(), tick_}.write(w);
+  w.u64(seed_);
+  std::ostringstream rng;
+  rng << gen_;
+  w.str(rng.str());
+  w.u32(uint32_t(rules_.stone_sleep));
+  w.u32(uint32_t(rules_.mating_rest));
+
+  // species in the order of their kinds, so they get the same kinds when loaded
+  w.u8(unsigned(prototypes_.size()));
+  for (const auto& proto : prototypes_) {
+    const auto& s = *players_.at(proto->name());
+    w.str(s.name());
+    for (auto v : {s.alive(), s.dead(), s.kills(), s.feedings(), s.starved()}) {
+      w.u32(v);
+    }
+  }
+
+  std::vector<occupancy::kind> tiles;
+  tiles.reserve(std::size_t(geom_.width()) * geom_.height());
+  for (int y = 0; y < geom_.height(); ++y) {
+    for (int x = 0; x < geom_.width(); ++x) {
+      tiles.push_back(occupancy_.at(geom_.index(point(int16_t(x), int16_t(y)))));
+    }
+  }
+  w.bytes(tiles.data(), tiles.size());
+
+  // then every critter, in the same order as the tiles
+  for (int y = 0; y < geom_.height(); ++y) {
+    for (int x = 0; x < geom_.width(); ++x) {
+      auto p = geom_.index(point(int16_t(x), int16_t(y)));
+      if (occupancy_.at(p) < occupancy::FIRST_SPECIES) continue;
+      auto state = tile(p)->save_state();
+      // a parked critter hasn't been ticked since it was parked
+      if (auto n = naps_.find(p); n != naps_.end()) {
+        auto missed = int(tick_ - n->second.since);
+        state.food_remaining -= missed;
+        state.wait_time -= missed;
+      }
+      w.u8(unsigned(state.awake) | unsigned(state.mating) << 1 | unsigned(state.has_mated) << 2);
+      w.u32(uint32_t(state.baby_timer));
+      w.u32(uint32_t(state.food_remaining));
+      w.u32(uint32_t(state.wait_time));
+    }
+  }
+}
+
+void game::load(std::istream& in, const std::vector<std::shared_ptr<critter>>& players) {
+  assert (population_ == 0 && occupancy_.count(occupancy::EMPTY) == std::size_t(geom_.width()) * geom_.height());
+  try {
+    read_world(in, players);
+  } catch (const std::exception&) {
+    // give the terminal back, so the caller can explain
+    view_->teardown();
+    throw;
+  }
+  geom_.for_each([this](std::size_t p) { draw(p); });
+  view_->update_time(tick_);
+}
+
+void game::read_world(std::istream& in, const std::vector<std::shared_ptr<critter>>& players) {
+  checkpoint_in r(in);
+  auto header = checkpoint_header::read(r);
+  if (header.width != geom_.width() || header.height != geom_.height()) {
+    throw std::runtime_error("the saved world is " + std::to_string(header.width) + 'x' +
+                             std::to_string(header.height) + ", not " + std::to_string(geom_.width()) +
+                             'x' + std::to_string(geom_.height()));
+  }
+  tick_ = header.tick;
+  wakeups_.reset(tick_);
+  seed_ = r.u64();
+  std::istringstream rng(r.str());
+  rng >> gen_;
+  if (!rng) throw std::runtime_error("the saved random state can't be read");
+  rules_.stone_sleep = int(int32_t(r.u32()));
+  rules_.mating_rest = int(int32_t(r.u32()));
+
+  const auto count = r.u8();
+  for (unsigned i = 0; i < count; ++i) {
+    auto name = r.str();
+    auto proto = std::find_if(players.begin(), players.end(),
+        [&name](const std::shared_ptr<critter>& c) { return c->name() == name; });
+    if (proto == players.end()) {
+      throw std::runtime_error("the saved world holds " + name + ", which is not playing");
+    }
+    unsigned stats[5];
+    for (auto& v : stats) v = r.u32();
+    players_[name] = std::make_shared<species>(name, stats[0], stats[1], stats[2], stats[3], stats[4]);
+    auto k = occupancy_.kind_of(**proto);
+    auto s = std::size_t(k - occupancy::FIRST_SPECIES);
+    if (s >= prototypes_.size()) prototypes_.resize(s + 1);
+    prototypes_[s] = *proto;
+  }
+
+  std::vector<occupancy::kind> tiles(std::size_t(geom_.width()) * geom_.height());
+  r.bytes(tiles.data(), tiles.size());
+  std::size_t i = 0;
+  for (int y = 0; y < geom_.height(); ++y) {
+    for (int x = 0; x < geom_.width(); ++x, ++i) {
+      auto k = tiles[i];
+      if (k >= occupancy::FIRST_SPECIES + count) {
+        throw std::runtime_error("the saved world holds an unknown kind of tile");
+      }
+      if (k == occupancy::EMPTY) continue;
+      auto p = geom_.index(point(int16_t(x), int16_t(y)));
+      occupancy_.set(p, k);
+      if (k < occupancy::FIRST_SPECIES) continue;
+      auto it = prototypes_[k - occupancy::FIRST_SPECIES]->create();
+      auto flags = r.u8();
+      critter::state state;
+      state.awake = (flags & 1) != 0;
+      state.mating = (flags & 2) != 0;
+      state.has_mated = (flags & 4) != 0;
+      state.baby_timer = int(int32_t(r.u32()));
+      state.food_remaining = int(int32_t(r.u32()));
+      state.wait_time = int(int32_t(r.u32()));
+      it->restore_state(state);
+      critters_[p] = std::move(it);
+      ++population_;
+    }
+  }
+}
+
+void game::report(bool paused) {
+  tracer::span span("report");
+  allocations::scope charged(allocations::REPORT);
+  if (shared_) shared_->publish(tick_, prototypes_, players_);
+  if (!control_) return;
+  if (paused) rate_ticks_ = 0;    // don't count the pause in the tick rate
+  metrics_.tick = tick_;
+  metrics_.ticks_per_second = paused? 0: ticks_per_second_;
+  metrics_.paused = paused;
+  metrics_.tick_ns = tick_ns_;
+  metrics_.species.resize(players_.size());
+  auto m = metrics_.species.begin();
+  for (const auto& p : players_) {
+    const auto& s = *p.second;
+    m->name = p.first;
+    m->alive = s.alive();
+    m->dead = s.dead();
+    m->kills = s.kills();
+    m->feedings = s.feedings();
+    m->starved = s.starved();
+    m->score = s.score();
+    ++m;
+  }
+  control_->publish(metrics_);
+}
+
+unsigned long game::quiet_ticks(unsigned long limit) const {
+  // a critter that isn't parked may move on the next tick
+  if (population_ == 0 || naps_.size() < population_) return 0;
+  auto next = wakeups_.next();
+  if (next <= tick_ + 1) return 0;
+  return std::min(limit, next - tick_ - 1);
+}
+
+void game::fast_forward(unsigned long ticks) {
+  tracer::span span("fast forward");
+  span.arg("ticks", ticks);
+  tick_ += ticks;
+  if (rate_ticks_ > 0) rate_ticks_ += ticks;
+  if (recorder_) recorder_->record(tick_);
+  view_->update_time(tick_);
+  view_->update_score(players_);
+  view_->redraw();
+}
+
+void game::park(std::size_t p, unsigned long turns) {
+  parked_.set(p);
+  naps_[p] = nap {tick_, tick_ + turns + 1};
+  wakeups_.schedule(tick_ + turns + 1, p);
+}
+
+void game::wake(std::size_t p) {
+  // the critter may have been killed, and the slot taken by another
+  auto n = naps_.find(p);
+  if (n == naps_.end() || n->second.until != tick_) return;
+  tile(p)->tick(int(n->second.until - n->second.since - 1));
+  naps_.erase(n);
+  parked_.reset(p);
+}
+
+void game::unpark(std::size_t p) {
+  if (!parked_.test(p)) return;
+  parked_.reset(p);
+  naps_.erase(p);
 }
 
 void game::update_tiles() {
-  for (const auto& t : tiles_) {
-    if (t.second->is_player()) {
-      update(t);
+  {
+    tracer::span span("wake");
+    allocations::scope charged(allocations::WAKE);
+    wakeups_.advance(tick_, [this](std::size_t p) { wake(p); });
+  }
+  movers_ = 0;
+  const auto n = prototypes_.size();
+  for (std::size_t i = 0; i < n; ++i) {
+    update_species((tick_ + i) % n);
+  }
+}
+
+void game::update_species(std::size_t s) {
+  const auto& proto = prototypes_[s];
+  tracer::span traced(tracer::on()? tracer::intern(proto->name()): nullptr, "species");
+  auto& slots = batch_slots_;
+  {
+    tracer::span span("age");
+    allocations::scope charged(allocations::AGE);
+    slots.clear();
+    occupancy_.for_each_except(occupancy::kind(occupancy::FIRST_SPECIES + s), parked_, [&slots](std::size_t p) {
+      slots.push_back(p);
+    });
+    slots.erase(std::remove_if(slots.begin(), slots.end(), [this](std::size_t p) {
+          return !tick(p);
+        }), slots.end());
+  }
+  movers_ += slots.size();
+  traced.arg("movers", slots.size());
+  if (slots.empty()) return;
+
+  const auto radius = proto->vision_radius();
+  {
+    tracer::span span("look");
+    allocations::scope charged(allocations::LOOK);
+    batch_views_.resize(slots.size());
+    for (std::size_t i = 0; i < slots.size(); ++i) {
+      auto& v = batch_views_[i];
+      v.self = tile(slots[i]).get();
+      for (std::size_t d = 0; d < directions.size(); ++d) {
+        v.neighbors[d] = &tile(geom_.translate(slots[i], directions[d]));
+      }
+      v.sight = look(slots[i], radius);
     }
   }
-  for (const auto& t : tiles_) {
-    t.second->set_update(false);
+  {
+    tracer::span span("move_batch", "critter");
+    allocations::scope charged(allocations::MOVE);
+    batch_moves_.assign(slots.size(), direction::CENTER);
+    proto->move_batch(batch_views_.data(), batch_moves_.data(), slots.size());
+  }
+
+  tracer::span span("act");
+  allocations::scope charged(allocations::ACT);
+  for (std::size_t i = 0; i < slots.size(); ++i) {
+    act(slots[i], batch_views_[i].self, batch_moves_[i]);
   }
-  view_->redraw(tiles_);
 }
 
 void game::init_tiles() {
-  assert(tiles_.empty());
+  assert(population_ == 0);
   if (debug_ != 0) std::cerr << "height: " << view_->height() << ", width: " << view_->width() << "\n";
-  for (int16_t x=0; x<=view_->width()-1; ++x) {
-    for (int16_t y=0; y<=view_->height()-1; ++y) {
-      point p = {x, y};
-      tiles_[p] = blank_tile;
-      blanks_[p] = blank_tile;
-    }
+#if defined(CRITTERS_WORLD_WIDTH) && defined(CRITTERS_WORLD_HEIGHT)
+  if (view_->width() != geom_.width() || view_->height() != geom_.height()) {
+    view_->teardown();
+    std::cerr << "This simulator was built for a " << geom_.width() << 'x' << geom_.height()
+              << " world, but the view is " << view_->width() << 'x' << view_->height() << ".\n";
+    std::cerr << "Exiting.\n\n";
+    exit(-1);
+  }
+#endif
+  geom_ = world_geometry(view_->width(), view_->height());
+  flows_.reset(&geom_, &occupancy_);
+  occupancy_.reset(&geom_);
+  critters_.assign(geom_.size(), nullptr);
+  parked_ = bitboard(geom_.size());
+  view_->watch(geom_, occupancy_, *this);
+}
+
+const std::shared_ptr<critter>& game::tile(std::size_t p) const {
+  auto k = occupancy_.at(p);
+  if (k < occupancy::FIRST_SPECIES) return terrain_[k];
+  return critters_[p];
+}
+
+void game::place(std::size_t p, std::shared_ptr<critter> it) {
+  if (!it->is_player()) {
+    place(p, occupancy_.kind_of(*it));
+    return;
+  }
+  auto k = occupancy_.kind_of(*it);
+  unpark(p);
+  if (occupancy_.at(p) < occupancy::FIRST_SPECIES) ++population_;
+  occupancy_.set(p, k);
+  critters_[p] = std::move(it);
+}
+
+void game::place(std::size_t p, occupancy::kind k) {
+  assert (k < occupancy::FIRST_SPECIES);
+  unpark(p);
+  if (occupancy_.at(p) >= occupancy::FIRST_SPECIES) {
+    critters_[p].reset();
+    --population_;
   }
+  occupancy_.set(p, k);
 }
 
-void game::update (const tile& t) {
-  const auto& pos = t.first;
-  const auto& it = t.second;
-  if (it->updated()) return;
+void game::draw(std::size_t p) {
+  if (history_) history_->drawn(p, *tile(p));
+  if (shared_) share(p);
+  view_->draw(geom_.to_point(p), *tile(p));
+}
+
+void game::share(std::size_t p) {
+  // the shared grid has no ghost tiles
+  auto at = geom_.to_point(p);
+  shared_->drawn(std::size_t(at.y) * std::size_t(geom_.width()) + std::size_t(at.x), *tile(p), occupancy_.at(p));
+}
 
-  it->set_update(true);
+bool game::tick (std::size_t pos) {
+  const auto& it = tile(pos);
   it->tick();  // update critter state variables
 
   if (it->food_remaining() == 0) {
+    if (logger::on(logger::event::STARVED)) {
+      logger::write(logger::event::STARVED, tick_, it->name(), geom_.to_point(pos));
+    }
     players_[it->name()]->add_starved();
-    tiles_[pos] = blank_tile;
-    view_->draw(pos, *tiles_[pos]);
+    place(pos, occupancy::EMPTY);
+    draw(pos);
+    return false;
   } else if (it->is_asleep() || it->is_mating()) {
-    view_->draw(pos, *it);
-  } else {
+    draw(pos);
+    // nothing changes for this critter until it wakes or is about to starve;
+    // babies are left alone, since they change when they grow up
+    auto turns = std::min(it->wait_remaining(), it->food_remaining() - 1);
+    if (turns > 1 && !it->is_baby()) park(pos, (unsigned long)turns);
+    return false;
+  }
+  return true;
+}
 
-    auto neighbors = get_neighbors(pos);
-    auto move_dir = it->move(neighbors);
-    if (move_dir <= direction::CENTER ||
-        move_dir > direction::NORTH_WEST) {
-      view_->draw(pos, *it);
-      return;
-    }
+void game::act (std::size_t pos, const critter* it, direction move_dir) {
+  // an earlier move in this batch may have changed things:
+  // this critter may have been picked as a mate
+  if (tile(pos).get() != it) return;
+  if (it->is_asleep() || it->is_mating() ||
+      move_dir <= direction::CENTER ||
+      move_dir > direction::NORTH_WEST) {
+    draw(pos);
+    return;
+  }
 
-    auto dest = pos.translate(pos, move_dir, view_->width(),view_->height());
-    if (auto can_move = [&pos, &it, &move_dir, this]() {
-          if (it->wait_remaining() != 0u)    return false;
-          auto tmp =  pos.translate(pos, move_dir, view_->width(),view_->height());
-          return tiles_[tmp] == blank_tile;
-        }; can_move()) {
-      move(pos, dest);
-    } else {
-      take_action(pos, dest);
-    }
-    view_->draw(pos, *tiles_[pos]);
-    view_->draw(dest, *tiles_[dest]);
+  auto dest = geom_.translate(pos, move_dir);
+  if (auto can_move = [&dest, &it, this]() {
+        if (it->wait_remaining() != 0u)    return false;
+        return occupancy_.at(dest) == occupancy::EMPTY;
+      }; can_move()) {
+    move(pos, dest);
+  } else {
+    take_action(pos, dest);
   }
+  draw(pos);
+  draw(dest);
 }
 
-void game::move (const point& src, const point& dest) {
+void game::move (std::size_t src, std::size_t dest) {
   assert (src != dest);
-  assert (tiles_[dest] == blank_tile || tiles_[dest]->name() == "Food");
-  assert (tiles_[dest]->name() != "Stone");
-  std::swap(tiles_[src], tiles_[dest]);
-  // view_->draw(src, *tiles_[src]);
-  // view_->draw(dest, *tiles_[dest]);
+  assert (occupancy_.at(src) >= occupancy::FIRST_SPECIES);
+  assert (occupancy_.at(dest) == occupancy::EMPTY);
+  critters_[dest] = std::move(critters_[src]);
+  occupancy_.swap(src, dest);
 }
 
 
 std::map<direction,  shared_ptr<critter>>
-game::get_neighbors(const point& p) {
+game::get_neighbors(std::size_t p) {
   std::map<direction, shared_ptr<critter>> neighbors;
   for (auto& dir: directions) {
-    auto new_posit = p.translate(p, dir, view_->width(),view_->height());
-    neighbors[dir] = tiles_[new_posit];
+    neighbors[dir] = tile(geom_.translate(p, dir));
   }
   assert (neighbors.size() == 8);
   return neighbors;
 }
 
-void game::take_action (const point& src, const point& dest) {
-  auto me = tiles_[src];
-  auto other = tiles_[dest];
+perception game::look(std::size_t p, int radius) const {
+  radius = std::max(radius, 1);
+  radius = std::min({radius, (geom_.width() - 1) / 2, (geom_.height() - 1) / 2});
+  auto center = geom_.to_point(p);
+  return perception(geom_.width(), geom_.height(), center.x, center.y, radius, this);
+}
+
+const std::shared_ptr<critter>& game::at(int x, int y) const {
+  return tile(geom_.index(point(int16_t(x), int16_t(y))));
+}
 
-  if ("Stone" == other->name()) {
-    if (debug_ != 0) std::cerr << me->name() << " at " << src << " tried to fight a stone. sleep it off.\n";
-    me->sleep(20);
+std::size_t game::random_blank() {
+  assert (occupancy_.count(occupancy::EMPTY) > 0);
+  // a few blind guesses are cheapest on a sparse world;
+  // after that, pick straight from the empty tiles
+  for (int tries = 0; tries < 8; ++tries) {
+    auto x = std::uniform_int_distribution<int> {0, geom_.width()-1} (gen_);
+    auto y = std::uniform_int_distribution<int> {0, geom_.height()-1} (gen_);
+    auto p = geom_.index(point(int16_t(x), int16_t(y)));
+    if (occupancy_.at(p) == occupancy::EMPTY) return p;
+  }
+  auto n = occupancy_.count(occupancy::EMPTY);
+  return occupancy_.select(occupancy::EMPTY,
+      std::uniform_int_distribution<std::size_t> {0, n-1} (gen_));
+}
+
+direction game::toward(const std::string& target, int x, int y) const {
+  occupancy::kind k;
+  if (!occupancy_.lookup(target, k)) return direction::CENTER;
+  return flows_.toward(k, geom_.index(point(int16_t(x), int16_t(y))));
+}
+
+direction game::away_from(const std::string& target, int x, int y) const {
+  occupancy::kind k;
+  if (!occupancy_.lookup(target, k)) return direction::CENTER;
+  return flows_.away_from(k, geom_.index(point(int16_t(x), int16_t(y))));
+}
+
+int game::distance(const std::string& target, int x, int y) const {
+  occupancy::kind k;
+  if (!occupancy_.lookup(target, k)) return -1;
+  auto d = flows_.distance(k, geom_.index(point(int16_t(x), int16_t(y))));
+  return d == flow_fields::unreachable? -1: d;
+}
+
+int game::count(const std::string& target, int x0, int y0, int x1, int y1) const {
+  occupancy::kind k;
+  if (!occupancy_.lookup(target, k)) return 0;
+  return int(occupancy_.count(k, x0, y0, x1, y1));
+}
+
+void game::take_action (std::size_t src, std::size_t dest) {
+  auto me = tile(src);
+  auto other = tile(dest);
+  auto other_kind = occupancy_.at(dest);
+
+  if (other_kind == occupancy::STONE) {
+    if (logger::on(logger::event::STONE)) {
+      logger::write(logger::event::STONE, tick_, me->name(), geom_.to_point(src),
+                    std::string(), point(), uint32_t(rules_.stone_sleep));
+    }
+    me->sleep(rules_.stone_sleep);
     me->sleep();  // inform critter we put it to sleep
-  } else if ("Food" == other->name()) {
+  } else if (other_kind == occupancy::FOOD) {
     process_food(src, dest);
-  } else if (me->name() == other->name()) {
+  } else if (occupancy_.at(src) == other_kind) {
     // 2 adult same species members can mate once
     if (auto can_mate = [&me, &other]() {
-          return (me->name() == other->name())
-            && !me->is_baby() 
+          return !me->is_baby() 
             && !other->is_baby() 
             && !me->is_parent() 
             && !other->is_parent() 
@@ -188,79 +759,85 @@ void game::take_action (const point& src, const point& dest) {
     }
   } else {
     // 2 different species always fight
-    if (auto can_fight = [&src, &dest, this]() {
-        auto other =  tiles_[dest];
-        if(tiles_[src]->wait_remaining() > 0 || other == blank_tile) {
+    if (auto can_fight = [&me, &other_kind]() {
+        if(me->wait_remaining() > 0 || other_kind == occupancy::EMPTY) {
           return false;
         }
-        return other->is_player();
+        return other_kind >= occupancy::FIRST_SPECIES;
       }; can_fight()) {
       process_fight(src, dest);
     }
   }
 }
 
-void game::process_food(const point& src, const point& dest)   {
-  auto src_it = tiles_[src];
+void game::process_food(std::size_t src, std::size_t dest)   {
+  auto src_it = tile(src);
   if (src_it->eat()) {
+    if (logger::on(logger::event::ATE)) {
+      logger::write(logger::event::ATE, tick_, src_it->name(), geom_.to_point(src),
+                    "food", geom_.to_point(dest));
+    }
     src_it->eat_food();
     players_[src_it->name()]->add_feeding();
 
-    tiles_[dest] = blank_tile;
+    place(dest, occupancy::EMPTY);
     move(src,dest);
     // make more food somewhere else
-    auto food_spot = [&, this]() {
-      auto random_it = std::next(std::begin(tiles_), std::uniform_int_distribution<int> {0, int(tiles_.size()-1)} (gen));
-      return std::get<0>(*random_it);
-    };
-    auto p = food_spot();
-    while (tiles_[p] != blank_tile) {
-      p = food_spot();
+    if (occupancy_.count(occupancy::EMPTY) > 0) {
+      tracer::span span("respawn food");
+      auto p = random_blank();
+      place(p, occupancy::FOOD);
+      draw(p);
     }
-    tiles_[p] = std::make_shared<food>();
-    view_->draw(p, *tiles_[p]);
   }
 }
 
-void game::process_mate(const point& src, const point& dest)   {
-  auto dad = tiles_[src];
-  auto mom = tiles_[dest];
+void game::process_mate(std::size_t src, std::size_t dest)   {
+  auto dad = tile(src);
+  auto mom = tile(dest);
 
-  auto neighbors = get_neighbors(src);
   direction dir = direction::CENTER;
   // find empty neightbor to put baby
   for (int i=0; i<8; ++i) {
-    if ("Empty" == neighbors[directions[i]]->name()) {
+    if (occupancy_.at(geom_.translate(src, directions[i])) == occupancy::EMPTY) {
       dir = directions[i];
     }
   }
   if (dir == direction::CENTER) {
-    if(debug_ != 0)    std::cerr << "Could not find a place to have baby.\n";
+    if (logger::on(logger::event::NO_ROOM)) {
+      logger::write(logger::event::NO_ROOM, tick_, mom->name(), geom_.to_point(src),
+                    mom->name(), geom_.to_point(dest));
+    }
   } else {
-    auto birthplace = src.translate(src, dir, view_->width(),view_->height());
+    auto birthplace = geom_.translate(src, dir);
     auto baby = mom->create();
     players_[baby->name()]->add_member();
-    mom->start_mating(9);
-    dad->start_mating(9);
-
-    tiles_[birthplace] = baby;
-    view_->draw(birthplace, *baby);
-    view_->draw(src, *mom);
-    view_->draw(dest, *dad);
-    if(debug_ != 0)    std::cerr << mom->name() << " made baby. The baby is at: " << birthplace << "\n";
+    mom->start_mating(rules_.mating_rest);
+    dad->start_mating(rules_.mating_rest);
+
+    place(birthplace, baby);
+    draw(birthplace);
+    draw(src);
+    draw(dest);
+    if (logger::on(logger::event::BABY)) {
+      logger::write(logger::event::BABY, tick_, mom->name(), geom_.to_point(dest),
+                    baby->name(), geom_.to_point(birthplace));
+    }
   }
 }
 
-void game::process_fight(const point& src, const point& dest)   {
-  auto attacker = tiles_[src];
-  auto defender = tiles_[dest];
+void game::process_fight(std::size_t src, std::size_t dest)   {
+  auto attacker = tile(src);
+  auto defender = tile(dest);
   auto results = get_fight_results(&*attacker, &*defender);
 
-  if(!defender->is_player()) {
-    std::cerr << "Error! fighting a non-player entitiy\n";
-    std::cerr << "\tName: " << defender->name() << " @" << defender << "\n";
-    std::cerr << "\tSource pt: " << src << ", Dest pt: " << dest << "\n";
-    std::cerr << "\tBlank_tile: " << defender->name() << " @" << blank_tile << "\n";
+  if (!defender->is_player() && logger::on(logger::event::NOT_A_PLAYER)) {
+    logger::write(logger::event::NOT_A_PLAYER, tick_, attacker->name(), geom_.to_point(src),
+                  defender->name(), geom_.to_point(dest));
+  }
+  if (logger::on(logger::event::FIGHT)) {
+    logger::write(logger::event::FIGHT, tick_, attacker->name(), geom_.to_point(src),
+                  defender->name(), geom_.to_point(dest), uint32_t(results));
   }
 
   //if the attacker wins, move to the dest tile
@@ -268,13 +845,12 @@ void game::process_fight(const point& src, const point& dest)   {
   //On a draw, nothing else happens
 
   if (results == game::fight_results::ATTACKER) {
-    tiles_[dest] = blank_tile;
-    view_->draw(dest, *tiles_[dest]);
+    place(dest, occupancy::EMPTY);
+    draw(dest);
     move(src,dest);
     update_kill_stats(&*attacker, &*defender);
   } else if (results == game::fight_results::DEFENDER) {
-    tiles_[src] = blank_tile;
-    // view_->draw(src, *tiles_[src]);
+    place(src, occupancy::EMPTY);
     update_kill_stats(&*defender, &*attacker);
   } else {
     attacker->draw();   // report back to attacker
@@ -288,6 +864,7 @@ game::get_fight_results (critter* attacker, critter* defender) {
     return game::fight_results::ATTACKER;
   }
   using Attack = critter::attack;
+  tracer::span span("fight", "critter");
   auto a_attack = attacker->fight(defender->name());
   auto d_attack = defender->fight(attacker->name());
   if (a_attack < Attack::ROAR || a_attack > Attack::SCRATCH) a_attack = Attack::FORFEIT;
@@ -316,12 +893,8 @@ void game::update_kill_stats(critter* winner, critter* loser) {
 
 void game::add_item(shared_ptr<critter> item, const int num_items) {
   assert(item != nullptr);
-  typedef std::unordered_map<point,shared_ptr<critter>>::value_type tile_type;
 
-  if (int free = count_if(tiles_.begin(), tiles_.end(), 
-      [&](tile_type t) {
-        return t.second == this->blank_tile;
-      }); free < num_items) {
+  if (int free = int(occupancy_.count(occupancy::EMPTY)); free < num_items) {
     view_->teardown();
     std::cerr << "Not enough blank tiles remaining to add " 
               << num_items << ' ' << item->name() << std::endl;
@@ -330,22 +903,64 @@ void game::add_item(shared_ptr<critter> item, const int num_items) {
     exit(-1);
   }
 
+  // terrain is not made of critters; only players need one each
   for (auto i = 0; i < num_items; ++i) {
-    auto c = item->create();
-    auto next_point = [&, this]() {
-      auto random_it = std::next(std::begin(blanks_), std::uniform_int_distribution<int> {0, int(blanks_.size()-1)} (gen));
-      return std::get<0>(*random_it);
-    };
-    point p = next_point();
-    assert(tiles_[p] == blank_tile);
-    tiles_[p] = c;
-    blanks_.erase(p);
-    view_->draw(p, *c);
+    auto c = item->is_player()? item->create(): item;
+    auto p = random_blank();
+    place(p, c);
+    draw(p);
   }
 
   //add item to species set
   if (item->is_player()) {
     players_[item->name()] = std::make_shared<species>(item->name(), num_items);
+    auto s = std::size_t(occupancy_.kind_of(*item) - occupancy::FIRST_SPECIES);
+    if (s >= prototypes_.size()) prototypes_.resize(s + 1);
+    prototypes_[s] = item;
+  }
+}
+
+void game::generate(int stones, int food,
+                    const std::vector<std::pair<shared_ptr<critter>, int>>& players,
+                    const layout& shape) {
+  assert (population_ == 0 && occupancy_.count(occupancy::EMPTY) == std::size_t(geom_.width()) * geom_.height());
+  std::vector<world_generator::population> populations;
+  std::size_t total = std::size_t(stones) + std::size_t(food);
+  for (const auto& s: players) {
+    auto k = occupancy_.kind_of(*s.first);
+    populations.push_back({k, std::size_t(s.second)});
+    total += std::size_t(s.second);
+
+    players_[s.first->name()] = std::make_shared<species>(s.first->name(), s.second);
+    auto i = std::size_t(k - occupancy::FIRST_SPECIES);
+    if (i >= prototypes_.size()) prototypes_.resize(i + 1);
+    prototypes_[i] = s.first;
+  }
+  if (total > occupancy_.count(occupancy::EMPTY)) {
+    view_->teardown();
+    std::cerr << "Not enough blank tiles to add " << total << " items.\n";
+    std::cerr << "Try reducing critters, food, or stones, or increasing x and y.\n\n";
+    std::cerr << "Exiting.\n\n";
+    exit(-1);
+  }
+
+  world_generator gen(geom_.width(), geom_.height(), gen_());
+  auto plan = gen.plan(std::size_t(stones), std::size_t(food), populations, shape);
+
+  // write the plan straight into the world
+  std::size_t i = 0;
+  for (int y = 0; y < geom_.height(); ++y) {
+    for (int x = 0; x < geom_.width(); ++x, ++i) {
+      auto k = plan[i];
+      if (k == occupancy::EMPTY) continue;
+      auto p = geom_.index(point(int16_t(x), int16_t(y)));
+      occupancy_.set(p, k);
+      if (k >= occupancy::FIRST_SPECIES) {
+        critters_[p] = prototypes_[k - occupancy::FIRST_SPECIES]->create();
+        ++population_;
+      }
+      draw(p);
+    }
   }
 }
 
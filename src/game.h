@@ -1,22 +1,54 @@
 #ifndef MESA_CRITTERS_GAME_H
 #define MESA_CRITTERS_GAME_H
 
+#include <array>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <iosfwd>
 #include <map>
 #include <memory>
+#include <random>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "view.h"
+#include "allocations.h"
+#include "checkpoint.h"
+#include "control_socket.h"
 #include "critter.h"
 #include "direction.h"
+#include "flow_fields.h"
+#include "food.h"
+#include "geometry.h"
+#include "history.h"
+#include "neighborhood.h"
+#include "occupancy.h"
+#include "perception.h"
 #include "point.h"
+#include "recorder.h"
+#include "shared_world.h"
 #include "species.h"
+#include "stone.h"
+#include "timer_wheel.h"
+#include "world_generator.h"
+
+/**
+ * Rule constants that are not part of the critter interface.
+ * The defaults are the classic rules.
+ */
+struct rules {
+  int stone_sleep = 20;   /**< turns a critter sleeps after running into a stone */
+  int mating_rest = 9;    /**< turns both parents rest after mating */
+};
 
 /**
  * The main critter simulation controller.
+ *
+ * The simulator also answers the questions critters ask through perception::oracle.
  */
-class game {
+class game : private perception::oracle {
   
   public:
     /**
@@ -29,6 +61,26 @@ class game {
      * Start running the simulation.
      */
     void start();
+    /**
+     * Run the simulation without waiting for keystrokes.
+     * Ticks follow each other as fast as possible, unless slowed down through
+     * the control socket.  The final scores are written to std::cout.
+     * @param ticks stop after this many ticks, or 0 to run until
+     *        one species is left or a quit command is received
+     */
+    void run(unsigned long ticks);
+    /**
+     * Run the simulation without waiting for keystrokes or reporting the scores.
+     * @param ticks stop after this many ticks, or 0 to run until
+     *        one species is left or a quit command is received
+     * @see run()
+     */
+    void play(unsigned long ticks);
+    /**
+     * Empty the world, so it can be filled again with generate().
+     * The view and the storage for the world are kept.
+     */
+    void reset();
     /**
      * Turns debug output on at the specified level.
      * Currently, the only level defined is 1.
@@ -40,6 +92,86 @@ class game {
      */
     void set_view(std::unique_ptr<view> v);
 
+    /**
+     * Publish metrics to, and take commands from, a control socket.
+     * Commands from the socket are handled just like keystrokes.
+     */
+    void set_control(std::unique_ptr<control_socket> c);
+
+    /**
+     * Publish the world to other processes through shared memory, after every tick.
+     * @param name the name of the shared memory segment, such as /critters
+     * @throws std::system_error if the segment can't be made.
+     *         The view is torn down first.
+     */
+    void set_shared(const std::string& name);
+
+    /**
+     * Run the code of every species in a worker process of its own.
+     * Call before set_view(), with the players to pass to generate() or load(),
+     * and before starting any thread, so the workers inherit none of its state.
+     * @param players the players, whose critters are replaced with stand-ins
+     * @throws std::system_error if a worker can't be started,
+     *         std::invalid_argument if there are too many species
+     * @see remote_species
+     */
+    void isolate(std::vector<std::pair<std::shared_ptr<critter>, int>>& players);
+
+    /**
+     * Write a checkpoint every so many ticks.
+     * @param c where the checkpoints are kept
+     * @param every the number of ticks between checkpoints
+     */
+    void set_checkpoints(std::unique_ptr<checkpointer> c, unsigned long every);
+    /**
+     * Record the counters of every species as the simulation runs.
+     * The recording starts over with each call to start() or play(),
+     * and is written when the simulation stops, or on demand with the 'e' command.
+     * @param r the recorder
+     */
+    void set_recorder(std::unique_ptr<recorder> r);
+    /**
+     * Write the state of the world at the end of the current tick.
+     * Critters are saved as the simulator sees them;
+     * state kept by the critter classes themselves is not saved.
+     * @param out where to write
+     */
+    void save(std::ostream& out) const;
+    /**
+     * Fill an empty world with a saved one, in place of generate().
+     * The random choices of the simulator carry on as they would have.
+     * @param in where to read the world from
+     * @param players a critter of every species that may be in the saved world
+     * @throws std::runtime_error if the world can't be read, is a different size
+     *         than this one, or holds a species not in players.
+     *         The view is torn down first.
+     */
+    void load(std::istream& in, const std::vector<std::shared_ptr<critter>>& players);
+
+    /**
+     * Seed the random choices made by the simulator, to make a run repeatable.
+     * By default, the seed is picked at random.
+     * Critters making random choices of their own are not affected.
+     */
+    void set_seed(uint64_t seed);
+    /**
+     * @return the seed of the random choices made by the simulator
+     */
+    uint64_t seed() const { return seed_; }
+
+    /**
+     * Change the rules of the world.
+     */
+    void set_rules(const rules& r) { rules_ = r; }
+
+    /**
+     * @return the number of ticks played
+     */
+    unsigned long ticks() const { return tick_; }
+    /**
+     * @return the scores of every species, keyed by name
+     */
+    const std::map<std::string, std::shared_ptr<species>>& scores() const { return players_; }
 
     /**
      * Seeds the world with some number of Entities.
@@ -48,6 +180,18 @@ class game {
      */
     void add_item(std::shared_ptr<critter> item, const int num_items);
 
+    /**
+     * Fill an empty world with stones, food and critters in one pass.
+     * Much faster than add_item on large worlds.
+     * @param stones the number of stones
+     * @param food the number of food items
+     * @param players the critter each species is made from, and the number of members
+     * @param shape how to arrange everything
+     */
+    void generate(int stones, int food,
+                  const std::vector<std::pair<std::shared_ptr<critter>, int>>& players,
+                  const layout& shape = layout());
+
   private:
     /** 
      * Process runtime keystrokes from users 
@@ -58,6 +202,10 @@ class game {
      * what level of verbosity, or what type of debug statements to produce.
      */
     int  debug_ = 0;
+    /**
+     * The rule constants in effect.
+     */
+    rules rules_;
 
     /**
      * The current move number.
@@ -70,23 +218,118 @@ class game {
      */
     std::unique_ptr<view> view_ = nullptr;
     /**
-     * Represent each valid position within the game world.
-     * As far as tiles are concerned, everything is a 'critter',
-     * whether it is actually a critter, an obstacle or other non-player
-     * entity, or a blank tile.
+     * Where metrics are published, if anywhere.
+     */
+    std::unique_ptr<control_socket> control_ = nullptr;
+    /**
+     * Where the world is published for other processes, if anywhere.
      */
-    std::unordered_map<point,  std::shared_ptr<critter>> tiles_;
+    std::unique_ptr<shared_world> shared_ = nullptr;
     /**
-     * Stores blank tiles.
-     * @todo as this is used mostly during initiialization, there is probably away to 
-     * refactor this out of the class and push it down as a local variable.
+     * Where checkpoints are written, if anywhere.
      */
-    std::unordered_map<point,  std::shared_ptr<critter>> blanks_;
+    std::unique_ptr<checkpointer> checkpoints_ = nullptr;
+    unsigned long checkpoint_every_ = 0;    /**< ticks between checkpoints */
+    unsigned long next_checkpoint_ = 0;     /**< the tick the next checkpoint is due */
+    /**
+     * The recent past, for stepping back through it.  Kept by start() only.
+     */
+    std::unique_ptr<history> history_ = nullptr;
+    /**
+     * The most bytes of history kept; a few thousand ticks of a busy screen.
+     */
+    static constexpr std::size_t history_budget = std::size_t(64) << 20;
+    /**
+     * Where the species counters are recorded, if anywhere.
+     */
+    std::unique_ptr<recorder> recorder_ = nullptr;
+    /**
+     * The snapshot handed to control_ after each tick.
+     * Swapped with the previous one, so its storage is reused.
+     */
+    metrics metrics_;
+    /**
+     * Histogram of tick durations since the start.
+     * @see metrics::tick_ns
+     */
+    std::array<uint64_t, metrics::buckets> tick_ns_ {};
+    std::chrono::steady_clock::time_point rate_since_;  /**< start of the tick rate window */
+    unsigned long rate_ticks_ = 0;                      /**< ticks in the tick rate window */
+    double ticks_per_second_ = 0;                       /**< tick rate over the last full window */
+    /**
+     * Heap allocations of this thread when counting started, and at the end of the last tick.
+     * Only counted when built with TRACK_ALLOCATIONS.
+     */
+    allocations::table allocations_since_ {}, allocations_last_ {};
+    unsigned long allocations_from_ = 0;        /**< the tick counting started */
+    uint64_t allocations_worst_ = 0;            /**< the most allocations in one tick */
+    unsigned long allocations_worst_tick_ = 0;  /**< the tick they were made in */
+    /**
+     * Maps world positions onto storage slots and finds neighboring slots.
+     */
+    world_geometry geom_;
+    /**
+     * The player in each slot of the world, or nullptr.
+     * Everything else in the world is terrain, which is only recorded in occupancy_.
+     */
+    std::vector<std::shared_ptr<critter>> critters_;
+    std::size_t population_ = 0;    /**< the number of players in critters_ */
+    /**
+     * The seed gen_ was last seeded with.
+     */
+    uint64_t seed_ = std::random_device {}();
+    /**
+     * Source of the random choices made by the simulator.
+     */
+    std::mt19937_64 gen_ {seed_};
+    /**
+     * Distances from every tile to the nearest food and the nearest member of each species.
+     * Built from occupancy_ when a critter first asks, then kept current from the tiles it says changed.
+     */
+    flow_fields flows_;
+    /**
+     * What kind of thing occupies each tile, with one bitboard per kind.
+     * For tiles without a player, this is the terrain: empty, food or stone.
+     * Kept current by place() and move().
+     */
+    occupancy occupancy_;
 
     /**
      * Stores the information used to update scores.
      */
     std::map<std::string, std::shared_ptr<species>> players_;
+    /**
+     * The critter each species was added with, indexed by occupancy kind less
+     * occupancy::FIRST_SPECIES.  Asked to move the whole species each turn.
+     */
+    std::vector<std::shared_ptr<critter>> prototypes_;
+
+    // scratch space for update_species, reused every turn
+    std::vector<std::size_t> batch_slots_;     /**< slots of the species members that can move */
+    std::vector<neighborhood> batch_views_;    /**< what each of those members sees */
+    std::vector<direction> batch_moves_;       /**< where each of those members wants to go */
+    /**
+     * The number of critters that were able to move on the last tick.
+     */
+    std::size_t movers_ = 0;
+
+    /**
+     * The ticks a parked critter sits out.
+     */
+    struct nap {
+      unsigned long since;    /**< the last tick the critter was ticked */
+      unsigned long until;    /**< the tick it is ticked again */
+    };
+    /**
+     * Critters asleep or mating with ticks to wait are parked: skipped every
+     * tick until they are due to change, then brought up to date all at once.
+     * Nothing about a parked critter that the simulator looks at changes while
+     * it is parked, so it can still be attacked as usual.
+     * The food and wait counters of a parked critter lag until it wakes.
+     */
+    bitboard parked_;
+    std::unordered_map<std::size_t, nap> naps_;   /**< the nap of each parked critter, by slot */
+    timer_wheel<std::size_t> wakeups_;            /**< the slot of each parked critter, by tick to wake */
 
     /**
      * Represents the results between two critters fighting.
@@ -103,18 +346,106 @@ class game {
      * By default, all tiles are initially empty.
      */
     void  init_tiles();
+    /**
+     * Advance the simulation by one tick, timing it.
+     * @return false if one species or fewer is left standing
+     */
+    bool  step();
+    /**
+     * Write a checkpoint, if one is due.
+     */
+    void  checkpoint();
+    /**
+     * Show an earlier or later tick from the history, without playing it.
+     * Stops at the oldest tick kept and at the latest tick played.
+     * @param ticks the number of ticks to move; negative to go back
+     */
+    void  rewind(long ticks);
+    /**
+     * Write the species counters recorded so far, if they are being recorded.
+     * A failure is not reported here; the same files are written again when the
+     * simulation stops, and a failure then is.
+     */
+    void  export_series();
+    /**
+     * Read a saved world into the tiles and scores.
+     * @see load()
+     */
+    void  read_world(std::istream& in, const std::vector<std::shared_ptr<critter>>& players);
+    /**
+     * Publish a snapshot of the simulation to the control socket and the
+     * shared world, whichever there are.
+     * @param paused true if the simulation is paused
+     */
+    void  report(bool paused);
+    /**
+     * Start counting heap allocations from the current tick.
+     */
+    void  count_allocations();
+    /**
+     * Write the heap allocations per tick to std::cerr, if they were counted.
+     */
+    void  report_allocations() const;
+    /**
+     * Count the ticks ahead in which no critter can move and none starves.
+     * That is the case while every critter is parked.
+     * @param limit the most ticks worth counting
+     * @return the number of quiet ticks, up to limit
+     */
+    unsigned long quiet_ticks(unsigned long limit) const;
+    /**
+     * Skip over quiet ticks.
+     * The parked critters catch up when they wake; the view is drawn once, at the end.
+     * @param ticks the number of ticks to skip; no more than quiet_ticks()
+     */
+    void  fast_forward(unsigned long ticks);
+    /**
+     * Skip a critter until it is due to wake or starve.
+     * @param p the slot of the critter
+     * @param turns the ticks to skip
+     */
+    void  park(std::size_t p, unsigned long turns);
+    /**
+     * Bring a parked critter up to date, so it is ticked again from this tick on.
+     * Does nothing if the critter has since been removed.
+     * @param p the slot of the critter
+     */
+    void  wake(std::size_t p);
+    /**
+     * Forget that the critter on a tile is parked, because it is being removed.
+     * @param p the slot of the tile
+     */
+    void  unpark(std::size_t p);
     /**
      * Update every tile in the simulation.
-     * Calls update and modifies critters according to the rules of the game.
+     * Each species moves in turn; the species that moves first rotates every tick.
      */
     void  update_tiles();
 
     /**
-     * Update is the starting point for all movement and action initiated by a critter
+     * Move every member of one species.
+     * Members are ticked, then the ones that can move are asked where to go in a
+     * single batch, then each move is carried out.
+     * @param s the species, as an index into prototypes_
+     */
+    void  update_species   (std::size_t s);
+
+    /**
+     * Advance the state of the critter on a tile by one time step.
+     * A critter that starves is removed.
+     * @param pos the slot of a game tile holding a player
+     * @return true if the critter is able to move this turn
+     */
+    bool  tick             (std::size_t pos);
+
+    /**
+     * Act is the starting point for all movement and action initiated by a critter
      * each time step.
-     * @param t a reference to a game tile
+     * @param pos the slot of a game tile
+     * @param it the critter that decided to move, which may no longer be on the tile
+     * @param move_dir the direction it wants to move
      */
-    void  update           (const std::pair<point,  std::shared_ptr<critter>>& t);
+    void  act              (std::size_t pos, const critter* it, direction move_dir);
 
     /**
      * Move a critter from a source point to a destination.
@@ -124,35 +455,35 @@ class game {
      * @param src the position where this critter currently resides (origin position)
      * @param dest the destintation position
      */
-    void  move             (const point& src, const point& dest);
+    void  move             (std::size_t src, std::size_t dest);
 
     /**
      * Controller for all non-movement actions taken by a critter (fight, mate, etc).
      * @param src the position where this critter currently resides (origin position)
      * @param dest the destintation position
      */
-    void  take_action      (const point& src, const point& dest);
+    void  take_action      (std::size_t src, std::size_t dest);
 
     /**
      * Controller what happens when a critter moves onto a tile containing food.
      * @param src the position where this critter currently resides (origin position)
      * @param dest the destination postion
      */
-    void  process_food     (const point& src, const point& dest);
+    void  process_food     (std::size_t src, std::size_t dest);
 
     /**
      * Controller what happens when a critter moves onto a tile containing a mate.
      * @param src the position where this critter currently resides
      * @param dest the position where the mate resides
      */
-    void  process_mate     (const point& src, const point& dest);
+    void  process_mate     (std::size_t src, std::size_t dest);
 
     /**
      * Controller what happens when a critter moves onto a tile containing food.
      * @param src the position where this critter currently resides
      * @param dest the position where the opponent resides
      */
-    void  process_fight    (const point& src, const point& dest);
+    void  process_fight    (std::size_t src, std::size_t dest);
 
     /**
      * Determine the outcome of two critters that are fighting.
@@ -171,10 +502,80 @@ class game {
 
     /**
      * Get all of the neighoring tiles that surround the indicated location.
-     * @param p The location representing the center of the request
+     * @param p The slot representing the center of the request
      * @return a map containing the contents of each of the surrounding 8 locations.
      */
-    std::map<direction,  std::shared_ptr<critter>> get_neighbors(const point& p);
+    std::map<direction,  std::shared_ptr<critter>> get_neighbors(std::size_t p);
+
+    /**
+     * Get a window onto the tiles surrounding the indicated location.
+     * The window reads the live world, so it is only valid until the world changes.
+     * @param p The slot representing the center of the request
+     * @param radius How far the window should reach.
+     *        Clamped so that the window never wraps onto itself.
+     * @return a window of the requested radius, or 1 if radius is smaller
+     */
+    perception look(std::size_t p, int radius) const;
+
+    /**
+     * Pick a random empty tile.
+     * @return the slot of the tile.  There must be at least one empty tile.
+     */
+    std::size_t random_blank();
+
+    /**
+     * @copydoc perception::oracle::at()
+     */
+    const std::shared_ptr<critter>& at(int x, int y) const override;
+    /**
+     * @copydoc perception::oracle::toward()
+     */
+    direction toward(const std::string& target, int x, int y) const override;
+    /**
+     * @copydoc perception::oracle::away_from()
+     */
+    direction away_from(const std::string& target, int x, int y) const override;
+    /**
+     * @copydoc perception::oracle::distance()
+     */
+    int distance(const std::string& target, int x, int y) const override;
+    /**
+     * @copydoc perception::oracle::count()
+     */
+    int count(const std::string& target, int x0, int y0, int x1, int y1) const override;
+
+    /**
+     * Get the contents of a tile.
+     * Terrain is represented by one shared critter per kind.
+     * @param p the slot of the tile
+     * @return the player on the tile, or the terrain
+     */
+    const std::shared_ptr<critter>& tile(std::size_t p) const;
+
+    /**
+     * Replace the contents of a tile.
+     * Every change to a tile, other than a move, must go through one of the place methods.
+     * @param p the slot of the tile
+     * @param it the new contents.  Anything that is not a player is stored as terrain.
+     */
+    void place(std::size_t p, std::shared_ptr<critter> it);
+    /**
+     * Replace the contents of a tile with terrain.
+     * @param p the slot of the tile
+     * @param k occupancy::EMPTY, occupancy::FOOD or occupancy::STONE
+     */
+    void place(std::size_t p, occupancy::kind k);
+
+    /**
+     * Render the contents of a tile.
+     * @param p the slot of the tile to draw
+     */
+    void draw(std::size_t p);
+    /**
+     * Note a change to a tile for the shared world.
+     * @param p the slot of the tile
+     */
+    void share(std::size_t p);
 
 
     /**
@@ -197,6 +598,13 @@ class game {
      */
     std::shared_ptr<critter> blank_tile = std::make_shared<game::EMPTY>();
 
+    /**
+     * The tile returned for each kind of terrain, indexed by occupancy kind.
+     */
+    const std::array<std::shared_ptr<critter>, occupancy::FIRST_SPECIES> terrain_ = {{
+      blank_tile, std::make_shared<food>(), std::make_shared<stone>()
+    }};
+
 };
 
 
@@ -0,0 +1,28 @@
+
+#include <cstdint>
+
+#include "direction.h"
+#include "geometry.h"
+
+geometry<0, 0>::geometry(int16_t width, int16_t height)
+  : width_(width)
+  , height_(height)
+  , stride_(std::size_t(width) + 2)
+{
+  assert (width > 0 && height > 0);
+  for (std::size_t d = 0; d < offset_.size(); ++d) {
+    offset_[d] = direction_dy[d] * std::ptrdiff_t(stride_) + direction_dx[d];
+  }
+
+  // every slot, ghost or not, resolves to the real tile it stands for
+  const std::size_t rows = std::size_t(height) + 2;
+  wrap_.resize(rows * stride_);
+  for (std::size_t r = 0; r < rows; ++r) {
+    auto y = (r + height - 1) % height;
+    for (std::size_t c = 0; c < stride_; ++c) {
+      auto x = (c + width - 1) % width;
+      wrap_[r * stride_ + c] = uint32_t(origin() + y * stride_ + x);
+    }
+  }
+}
+
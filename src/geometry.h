@@ -0,0 +1,230 @@
+#ifndef MESA_CRITTERS_GEOMETRY_H
+#define MESA_CRITTERS_GEOMETRY_H
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "direction.h"
+#include "point.h"
+
+/**
+ * Column offset of each direction, indexed by the underlying direction value.
+ */
+constexpr std::array<int, 9> direction_dx = {{ 0,  0,  1,  1,  1,  0, -1, -1, -1 }};
+/**
+ * Row offset of each direction, indexed by the underlying direction value.
+ */
+constexpr std::array<int, 9> direction_dy = {{ 0, -1, -1,  0,  1,  1,  1,  0, -1 }};
+
+/**
+ * Maps positions in a wrapping Critter world onto indices into flat tile storage.
+ *
+ * The primary template describes a world whose size is fixed at compile time.
+ * Tiles are stored densely in row-major order and all of the index arithmetic
+ * folds into constants.
+ * When both dimensions are a power of two, wrapping around an edge is a mask;
+ * otherwise it is a pair of conditional adds the compiler emits without branches.
+ *
+ * @tparam W the world width
+ * @tparam H the world height
+ * @see geometry<0,0> for worlds sized at runtime
+ */
+template <int16_t W = 0, int16_t H = 0>
+class geometry {
+  static_assert(W > 0 && H > 0, "a fixed world needs a positive width and height");
+
+  static constexpr bool pow2_ = (W & (W - 1)) == 0 && (H & (H - 1)) == 0;
+
+  public:
+    /**
+     * Create the geometry for a W x H world.
+     * The arguments exist so fixed and runtime geometries are constructed the same way.
+     * @param width the world width, which must equal W
+     * @param height the world height, which must equal H
+     */
+    explicit geometry(int16_t width = W, int16_t height = H) {
+      assert(width == W && height == H);
+      (void)width; (void)height;
+    }
+
+    /**
+     * @return the width of the world
+     */
+    static constexpr int16_t width()  { return W; }
+    /**
+     * @return the height of the world
+     */
+    static constexpr int16_t height() { return H; }
+    /**
+     * @return the number of storage slots needed to hold every tile
+     */
+    static constexpr std::size_t size() { return std::size_t(W) * H; }
+    /**
+     * @return the distance in storage slots between vertically adjacent tiles
+     */
+    static constexpr std::size_t stride() { return W; }
+    /**
+     * @return the storage slot of the tile at (0, 0)
+     */
+    static constexpr std::size_t origin() { return 0; }
+
+    /**
+     * Convert a world position to a storage slot.
+     * @param p the position, which must lie inside the world
+     * @return the storage slot for p
+     */
+    static std::size_t index(const point& p) {
+      return origin() + std::size_t(p.y) * stride() + std::size_t(p.x);
+    }
+    /**
+     * Convert a storage slot back to a world position.
+     * @param i a storage slot returned by index() or translate()
+     * @return the position stored at i
+     */
+    static point to_point(std::size_t i) {
+      return point(int16_t(i % W), int16_t(i / W));
+    }
+
+    /**
+     * Find the neighboring tile in a direction, wrapping around the world edges.
+     * @param i the storage slot of the starting tile
+     * @param movement the direction of movement
+     * @return the storage slot of the neighboring tile
+     */
+    static std::size_t translate(std::size_t i, direction movement) {
+      const auto d = static_cast<std::size_t>(movement);
+      int x = int(i % W) + direction_dx[d];
+      int y = int(i / W) + direction_dy[d];
+      if constexpr (pow2_) {
+        x &= W - 1;
+        y &= H - 1;
+      } else {
+        x += W * (x < 0);
+        x -= W * (x >= W);
+        y += H * (y < 0);
+        y -= H * (y >= H);
+      }
+      return std::size_t(y) * W + std::size_t(x);
+    }
+
+    /**
+     * Visit the storage slot of every tile in row-major order.
+     * @param f a callable taking a std::size_t
+     */
+    template <class F>
+    static void for_each(F&& f) {
+      for (std::size_t i = 0; i < size(); ++i) {
+        f(i);
+      }
+    }
+};
+
+/**
+ * Maps positions onto tile storage for a world whose size is known only at runtime.
+ *
+ * Storage is padded with one ghost row above and below the world and one ghost
+ * column on each side, so stepping one tile in any direction from a real tile
+ * always lands inside storage.
+ * A per-direction offset table turns that step into a single add, and a wrap table
+ * folds each ghost slot back onto the real tile on the opposite edge.
+ * Ghost slots never hold tiles.
+ */
+template <>
+class geometry<0, 0> {
+  public:
+    /**
+     * Create an empty geometry.
+     * Nothing may be indexed until it is assigned a real one.
+     */
+    geometry() = default;
+    /**
+     * Create the geometry for a world and precompute its offset and wrap tables.
+     * @param width the world width
+     * @param height the world height
+     */
+    geometry(int16_t width, int16_t height);
+
+    /**
+     * @return the width of the world
+     */
+    int16_t width()  const { return width_; }
+    /**
+     * @return the height of the world
+     */
+    int16_t height() const { return height_; }
+    /**
+     * @return the number of storage slots needed to hold every tile, including ghosts
+     */
+    std::size_t size() const { return wrap_.size(); }
+    /**
+     * @return the distance in storage slots between vertically adjacent tiles
+     */
+    std::size_t stride() const { return stride_; }
+    /**
+     * @return the storage slot of the tile at (0, 0)
+     */
+    std::size_t origin() const { return stride_ + 1; }
+
+    /**
+     * Convert a world position to a storage slot.
+     * @param p the position, which must lie inside the world
+     * @return the storage slot for p
+     */
+    std::size_t index(const point& p) const {
+      return origin() + std::size_t(p.y) * stride_ + std::size_t(p.x);
+    }
+    /**
+     * Convert a storage slot back to a world position.
+     * @param i a storage slot returned by index() or translate()
+     * @return the position stored at i
+     */
+    point to_point(std::size_t i) const {
+      i -= origin();
+      return point(int16_t(i % stride_), int16_t(i / stride_));
+    }
+
+    /**
+     * Find the neighboring tile in a direction, wrapping around the world edges.
+     * @param i the storage slot of the starting tile
+     * @param movement the direction of movement
+     * @return the storage slot of the neighboring tile
+     */
+    std::size_t translate(std::size_t i, direction movement) const {
+      return wrap_[i + offset_[static_cast<std::size_t>(movement)]];
+    }
+
+    /**
+     * Visit the storage slot of every tile in row-major order, skipping ghosts.
+     * @param f a callable taking a std::size_t
+     */
+    template <class F>
+    void for_each(F&& f) const {
+      for (std::size_t row = origin(), y = 0; y < std::size_t(height_); ++y, row += stride_) {
+        for (std::size_t i = row; i < row + std::size_t(width_); ++i) {
+          f(i);
+        }
+      }
+    }
+
+  private:
+    int16_t width_ = 0;                       /**< width of the world */
+    int16_t height_ = 0;                      /**< height of the world */
+    std::size_t stride_ = 0;                  /**< padded row length */
+    std::array<std::ptrdiff_t, 9> offset_ {}; /**< slot offset of each direction */
+    std::vector<uint32_t> wrap_;              /**< maps every slot, ghost or not, to a real tile */
+};
+
+/**
+ * The geometry used by the simulator.
+ * Configure with -DWORLD_WIDTH=# -DWORLD_HEIGHT=# to fix the world size at compile time.
+ */
+#if defined(CRITTERS_WORLD_WIDTH) && defined(CRITTERS_WORLD_HEIGHT)
+using world_geometry = geometry<CRITTERS_WORLD_WIDTH, CRITTERS_WORLD_HEIGHT>;
+#else
+using world_geometry = geometry<>;
+#endif
+
+#endif
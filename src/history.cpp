@@ -0,0 +1,68 @@
+#include "history.h"
+
+namespace {
+  /**
+   * @return a copy of the scores of every species, in name order
+   */
+  std::vector<species> copy(const std::map<std::string, std::shared_ptr<species>>& players) {
+    std::vector<species> result;
+    result.reserve(players.size());
+    for (const auto& p : players) {
+      result.push_back(*p.second);
+    }
+    return result;
+  }
+} // end anonymous namespace
+
+history::ghost::ghost(const look& l)
+  : critter("Ghost")
+  , glyph_(l.glyph)
+  , color_(::color(l.color))
+{
+  auto s = save_state();
+  s.awake = (l.state & look::ASLEEP) == 0;
+  s.mating = (l.state & look::MATING) != 0;
+  restore_state(s);
+}
+
+void history::reset(std::size_t slots, unsigned long tick,
+                    const std::map<std::string, std::shared_ptr<species>>& players) {
+  shown_.assign(slots, look());
+  changes_.clear();
+  frames_.clear();
+  dropped_ = 0;
+  committed_ = 0;
+  cursor_ = 0;
+  bytes_ = 0;
+  shown_tick_ = tick;
+  base_ = copy(players);
+}
+
+void history::commit(unsigned long tick, const std::map<std::string, std::shared_ptr<species>>& players) {
+  auto total = dropped_ + changes_.size();
+  frames_.push_back(frame {tick, committed_, total - committed_, copy(players)});
+  committed_ = total;
+  bytes_ += size_of(frames_.back());
+  cursor_ = frames_.size();
+  shown_tick_ = tick;
+
+  // keep the newest frame, however big
+  while (bytes_ > budget_ && frames_.size() > 1) {
+    auto& oldest = frames_.front();
+    bytes_ -= size_of(oldest);
+    changes_.erase(changes_.begin(), changes_.begin() + std::ptrdiff_t(oldest.count));
+    dropped_ += oldest.count;
+    base_ = std::move(oldest.scores);
+    frames_.pop_front();
+    --cursor_;
+  }
+}
+
+std::map<std::string, std::shared_ptr<species>> history::scores() const {
+  const auto& scores = cursor_ == 0? base_: frames_[cursor_ - 1].scores;
+  std::map<std::string, std::shared_ptr<species>> result;
+  for (const auto& s : scores) {
+    result[s.name()] = std::make_shared<species>(s);
+  }
+  return result;
+}
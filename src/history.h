@@ -0,0 +1,204 @@
+#ifndef MESA_CRITTERS_HISTORY_H
+#define MESA_CRITTERS_HISTORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "critter.h"
+#include "species.h"
+
+/**
+ * The recent past of the world as the view showed it, for stepping back and
+ * forth through it without playing it again.
+ *
+ * Every tile drawn during a tick that looks different than before is kept as a
+ * change: the slot, how it looked, and how it looks now.  The changes of a tick
+ * and the scores at its end make a frame.  Frames are kept oldest first, and the
+ * oldest are dropped once the changes and scores kept pass a budget, so the
+ * memory used follows how much the world changes, not how big it is.
+ *
+ * Stepping back undoes the changes of the frame shown, newest first;
+ * stepping forward applies them again.  Only the look of each tile is replayed,
+ * so no critter code runs.
+ */
+class history {
+  public:
+    /**
+     * How a tile looks: everything a view needs to draw it again.
+     */
+    struct look {
+      char glyph = ' ';                           /**< the character shown */
+      uint8_t color = uint8_t(::color::WHITE);    /**< the color, as its position in the color enum */
+      uint8_t state = 0;                          /**< ASLEEP and MATING bits */
+
+      static constexpr uint8_t ASLEEP = 1;        /**< the critter is asleep */
+      static constexpr uint8_t MATING = 2;        /**< the critter is mating */
+
+      /**
+       * @return how a tile holding a critter looks
+       */
+      static look of(const critter& it) {
+        return look {it.glyph(), uint8_t(it.color()),
+                     uint8_t((it.is_asleep()? ASLEEP: 0) | (it.is_mating()? MATING: 0))};
+      }
+      bool operator==(const look& rhs) const {
+        return glyph == rhs.glyph && color == rhs.color && state == rhs.state;
+      }
+      bool operator!=(const look& rhs) const { return !(*this == rhs); }
+    };
+
+    /**
+     * Stands in for whatever was on a tile, so a view can draw it again.
+     */
+    class ghost : public critter {
+      public:
+        /**
+         * Create a ghost of a look.
+         */
+        explicit ghost(const look& l);
+        char glyph() const override { return glyph_; }
+        enum color color() const override { return color_; }
+        std::shared_ptr<critter> create() override { return std::make_shared<ghost>(*this); }
+      private:
+        char glyph_;              /**< the character shown */
+        enum color color_;        /**< the color shown */
+    };
+
+    /**
+     * Create an empty history.
+     * @param budget the most bytes of changes and scores to keep
+     */
+    explicit history(std::size_t budget) : budget_(budget) {}
+
+    /**
+     * Forget every frame, and start from the world as it is.
+     * Every tile must then be filled in with prime().
+     * @param slots the number of tiles in the world
+     * @param tick the current tick
+     * @param players the current scores
+     */
+    void reset(std::size_t slots, unsigned long tick,
+               const std::map<std::string, std::shared_ptr<species>>& players);
+    /**
+     * Set how a tile looks now, without recording a change.
+     * Used to fill in the world as it is when recording starts.
+     */
+    void prime(std::size_t slot, const critter& it) { shown_[slot] = look::of(it); }
+
+    /**
+     * Note that a tile was drawn during the current tick.
+     * Nothing is kept unless it looks different than before.
+     * @param slot the slot of the tile
+     * @param it what is on the tile now
+     */
+    void drawn(std::size_t slot, const critter& it) {
+      auto now = look::of(it);
+      auto& before = shown_[slot];
+      if (now == before) return;
+      changes_.push_back(change {uint32_t(slot), before, now});
+      before = now;
+    }
+    /**
+     * Close the frame of a tick, with every change noted since the last one.
+     * The oldest frames are dropped if the budget is exceeded.
+     * @param tick the tick just played
+     * @param players the scores at the end of it
+     */
+    void commit(unsigned long tick, const std::map<std::string, std::shared_ptr<species>>& players);
+
+    /**
+     * @return the tick being shown
+     */
+    unsigned long shown() const { return shown_tick_; }
+    /**
+     * @return true if the view shows an earlier tick than the latest
+     */
+    bool rewound() const { return cursor_ < frames_.size(); }
+    /**
+     * @return the scores at the end of the tick being shown
+     */
+    std::map<std::string, std::shared_ptr<species>> scores() const;
+    /**
+     * @return the number of bytes of changes and scores kept
+     */
+    std::size_t bytes() const { return bytes_; }
+
+    /**
+     * Step back one tick.
+     * @param draw called with the slot and look of every tile that changes, in order
+     * @return false if there is no earlier tick to step back to
+     */
+    template <class F>
+    bool back(F&& draw) {
+      if (cursor_ == 0) return false;
+      const auto& f = frames_[--cursor_];
+      for (auto i = f.first + f.count; i-- > f.first; ) {
+        const auto& c = changes_[i - dropped_];
+        shown_[c.slot] = c.before;
+        draw(std::size_t(c.slot), c.before);
+      }
+      shown_tick_ = f.tick - 1;
+      return true;
+    }
+    /**
+     * Step forward one tick.
+     * @param draw called with the slot and look of every tile that changes, in order
+     * @return false if the latest tick is already shown
+     */
+    template <class F>
+    bool forward(F&& draw) {
+      if (!rewound()) return false;
+      const auto& f = frames_[cursor_++];
+      for (auto i = f.first; i < f.first + f.count; ++i) {
+        const auto& c = changes_[i - dropped_];
+        shown_[c.slot] = c.after;
+        draw(std::size_t(c.slot), c.after);
+      }
+      shown_tick_ = f.tick;
+      return true;
+    }
+
+  private:
+    /**
+     * A tile that looks different after a tick.
+     */
+    struct change {
+      uint32_t slot;      /**< the slot of the tile */
+      look before;        /**< how it looked */
+      look after;         /**< how it looks */
+    };
+    /**
+     * Everything that changed during a tick.
+     */
+    struct frame {
+      unsigned long tick;           /**< the tick */
+      std::size_t first;            /**< the position of its first change, counting dropped ones */
+      std::size_t count;            /**< the number of changes */
+      std::vector<species> scores;  /**< the scores at the end of the tick */
+    };
+
+    std::size_t budget_;                  /**< the most bytes to keep */
+    std::size_t bytes_ = 0;               /**< the bytes kept */
+    std::vector<look> shown_;             /**< how every tile looks in the view */
+    std::deque<change> changes_;          /**< the changes of every frame kept, and of the tick being played */
+    std::size_t dropped_ = 0;             /**< changes dropped from the front */
+    std::size_t committed_ = 0;           /**< changes in frames, counting dropped ones */
+    std::deque<frame> frames_;            /**< frames, oldest first */
+    std::size_t cursor_ = 0;              /**< the number of frames shown */
+    unsigned long shown_tick_ = 0;        /**< the tick shown */
+    std::vector<species> base_;           /**< the scores before the oldest frame */
+
+    /**
+     * @return the bytes kept for a frame
+     */
+    static std::size_t size_of(const frame& f) {
+      return sizeof(frame) + f.count * sizeof(change) + f.scores.size() * sizeof(species);
+    }
+};
+
+#endif
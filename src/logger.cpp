@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "logger.h"
+
+namespace {
+  constexpr std::size_t capacity = 8192;    // records on each ring; a power of 2
+
+  /**
+   * The records of one thread, from that thread to the writing thread.
+   */
+  struct ring {
+    std::array<logger::record, capacity> slots;
+    alignas(64) std::atomic<std::size_t> head {0};      // written by the owner
+    alignas(64) std::atomic<std::size_t> tail {0};      // written by the writing thread
+    std::atomic<uint64_t> dropped {0};
+    std::atomic<bool> closed {false};                   // the owner has exited
+  };
+
+  /**
+   * Everything the logger shares between threads.
+   */
+  struct state {
+    std::mutex lock;                                // guards everything but the rings' contents
+    std::condition_variable wake;
+    std::vector<std::shared_ptr<ring>> rings;
+    std::ostream* os = nullptr;
+    bool running = false;
+    std::thread writer;
+    uint64_t dropped = 0;                           // by rings already removed
+
+    ~state();
+  };
+
+  state& shared() {
+    static state s;
+    return s;
+  }
+
+  /**
+   * Marks the ring of a thread closed when the thread exits.
+   */
+  struct owner {
+    std::shared_ptr<ring> r;
+    ~owner() { if (r) r->closed.store(true, std::memory_order_release); }
+  };
+
+  ring& local() {
+    thread_local owner mine;
+    if (!mine.r) {
+      mine.r = std::make_shared<ring>();
+      auto& s = shared();
+      std::lock_guard<std::mutex> guard(s.lock);
+      s.rings.push_back(mine.r);
+    }
+    return *mine.r;
+  }
+
+  void copy(char* to, std::size_t size, const std::string& from) {
+    auto n = std::min(size - 1, from.size());
+    std::memcpy(to, from.data(), n);
+    to[n] = '\0';
+  }
+
+  void format(std::ostream& os, const logger::record& r) {
+    using event = logger::event;
+    os << r.tick << ' ' << logger::name(logger::category_of(r.what)) << ": ";
+    switch (r.what) {
+      case event::STONE:
+        os << r.who << " at " << r.at << " tried to fight a stone. asleep for " << r.arg << " ticks";
+        break;
+      case event::BABY:
+        os << r.who << " at " << r.at << " made a baby at " << r.other_at;
+        break;
+      case event::NO_ROOM:
+        os << r.who << " at " << r.at << " could not find a place to have a baby";
+        break;
+      case event::FIGHT:
+        os << r.who << " at " << r.at << " fought " << r.other << " at " << r.other_at
+           << (r.arg == 0? ": attacker won": r.arg == 1? ": defender won": ": draw");
+        break;
+      case event::NOT_A_PLAYER:
+        os << "error! " << r.who << " at " << r.at << " fought " << r.other
+           << ", which is not a player, at " << r.other_at;
+        break;
+      case event::ATE:
+        os << r.who << " at " << r.at << " ate food at " << r.other_at;
+        break;
+      case event::STARVED:
+        os << r.who << " at " << r.at << " starved";
+        break;
+      case event::WORKER_KILLED:
+        os << r.who << " forfeits: its worker was killed by signal " << r.arg;
+        break;
+      case event::WORKER_EXITED:
+        os << r.who << " forfeits: its worker exited with status " << r.arg;
+        break;
+      case event::WORKER_HUNG:
+        os << r.who << " forfeits: its worker took more than " << r.arg << " seconds to answer";
+        break;
+      case event::WORKER_LOST:
+        os << r.who << " forfeits: its worker can't be reached: " << std::strerror(int(r.arg));
+        break;
+    }
+    os << '\n';
+  }
+
+  /**
+   * Write every record on every ring, and forget rings whose owners have exited.
+   * Called by one thread at a time.
+   */
+  void drain(state& s) {
+    std::vector<std::shared_ptr<ring>> rings;
+    std::ostream* os;
+    {
+      std::lock_guard<std::mutex> guard(s.lock);
+      rings = s.rings;
+      os = s.os;
+    }
+    std::ostringstream text;
+    std::vector<ring*> finished;
+    for (auto& r: rings) {
+      // a ring is closed before its last record is read, so nothing is lost
+      auto closed = r->closed.load(std::memory_order_acquire);
+      auto tail = r->tail.load(std::memory_order_relaxed);
+      auto head = r->head.load(std::memory_order_acquire);
+      for (; tail != head; ++tail) {
+        format(text, r->slots[tail & (capacity - 1)]);
+      }
+      r->tail.store(tail, std::memory_order_release);
+      if (closed) finished.push_back(r.get());
+    }
+    if (os && text.tellp() > 0) {
+      *os << text.str() << std::flush;
+    }
+    if (!finished.empty()) {
+      std::lock_guard<std::mutex> guard(s.lock);
+      auto gone = std::remove_if(s.rings.begin(), s.rings.end(), [&finished](const std::shared_ptr<ring>& r) {
+          return std::find(finished.begin(), finished.end(), r.get()) != finished.end();
+        });
+      for (auto it = gone; it != s.rings.end(); ++it) {
+        s.dropped += (*it)->dropped.load(std::memory_order_relaxed);
+      }
+      s.rings.erase(gone, s.rings.end());
+    }
+  }
+
+  /**
+   * Stop the writing thread and write what is left.
+   */
+  void halt(state& s) {
+    std::thread writer;
+    {
+      std::lock_guard<std::mutex> guard(s.lock);
+      if (!s.running) return;
+      s.running = false;
+      writer = std::move(s.writer);
+    }
+    s.wake.notify_all();
+    writer.join();
+    drain(s);
+
+    uint64_t dropped = 0;
+    {
+      std::lock_guard<std::mutex> guard(s.lock);
+      dropped = s.dropped;
+      for (const auto& r: s.rings) {
+        dropped += r->dropped.load(std::memory_order_relaxed);
+      }
+    }
+    if (dropped != 0 && s.os) {
+      *s.os << "The log was full; " << dropped << " records were dropped.\n" << std::flush;
+    }
+  }
+
+  // a program that exits without stopping the log still gets all of it
+  state::~state() { halt(*this); }
+} // end anonymous namespace
+
+void logger::write(event e, unsigned long tick, const std::string& who, point at,
+                   const std::string& other, point other_at, uint32_t arg) {
+  auto& r = local();
+  auto head = r.head.load(std::memory_order_relaxed);
+  if (head - r.tail.load(std::memory_order_acquire) == capacity) {
+    r.dropped.store(r.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return;
+  }
+  auto& slot = r.slots[head & (capacity - 1)];
+  slot.tick = tick;
+  slot.what = e;
+  slot.arg = arg;
+  slot.at = at;
+  slot.other_at = other_at;
+  copy(slot.who, sizeof(slot.who), who);
+  copy(slot.other, sizeof(slot.other), other);
+  r.head.store(head + 1, std::memory_order_release);
+}
+
+void logger::start(std::ostream& os, level most, unsigned which) {
+  auto& s = shared();
+  std::lock_guard<std::mutex> guard(s.lock);
+  if (s.running) return;
+  s.os = &os;
+  s.running = true;
+  s.writer = std::thread([&s]() {
+      std::unique_lock<std::mutex> lock(s.lock);
+      while (s.running) {
+        lock.unlock();
+        drain(s);
+        lock.lock();
+        // producers never wake the writer; it looks every few milliseconds
+        s.wake.wait_for(lock, std::chrono::milliseconds(20), [&s]() { return !s.running; });
+      }
+    });
+
+  uint32_t mask = 0;
+  for (auto e = unsigned(event::STONE); e <= unsigned(event::WORKER_LOST); ++e) {
+    auto c = unsigned(category_of(event(e)));
+    if ((which >> c & 1u) && level_of(event(e)) <= most) mask |= 1u << e;
+  }
+  mask_.store(mask, std::memory_order_relaxed);
+}
+
+void logger::stop() {
+  mask_.store(0, std::memory_order_relaxed);
+  halt(shared());
+}
+
+bool logger::parse(const std::string& list, unsigned& which) {
+  which = 0;
+  std::istringstream in(list);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    if (item == "all") {
+      which = all;
+      continue;
+    }
+    unsigned c = 0;
+    while (c < categories && item != name(category(c))) ++c;
+    if (c == categories) return false;
+    which |= 1u << c;
+  }
+  return which != 0;
+}
+
+const char* logger::name(category c) {
+  switch (c) {
+    case category::FIGHT:       return "fight";
+    case category::MATE:        return "mate";
+    case category::FOOD:        return "food";
+    case category::STUN:        return "stun";
+    case category::STARVATION:  return "starvation";
+    case category::WORKER:      return "worker";
+  }
+  return "?";
+}
+
+logger::category logger::category_of(event e) {
+  switch (e) {
+    case event::STONE:          return category::STUN;
+    case event::BABY:
+    case event::NO_ROOM:        return category::MATE;
+    case event::FIGHT:
+    case event::NOT_A_PLAYER:   return category::FIGHT;
+    case event::ATE:            return category::FOOD;
+    case event::STARVED:        return category::STARVATION;
+    case event::WORKER_KILLED:
+    case event::WORKER_EXITED:
+    case event::WORKER_HUNG:
+    case event::WORKER_LOST:    return category::WORKER;
+  }
+  return category::FIGHT;
+}
+
+logger::level logger::level_of(event e) {
+  switch (e) {
+    case event::NOT_A_PLAYER:
+    case event::WORKER_KILLED:
+    case event::WORKER_EXITED:
+    case event::WORKER_HUNG:
+    case event::WORKER_LOST:    return level::ERROR;
+    case event::STONE:
+    case event::BABY:
+    case event::NO_ROOM:
+    case event::STARVED:        return level::INFO;
+    case event::FIGHT:
+    case event::ATE:            return level::DEBUG;
+  }
+  return level::DEBUG;
+}
@@ -0,0 +1,135 @@
+#ifndef MESA_CRITTERS_LOGGER_H
+#define MESA_CRITTERS_LOGGER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+#include "point.h"
+
+/**
+ * Logs what happens during a tick without slowing it down.
+ *
+ * Every message is an event of a category, logged at a level.
+ * Producers copy an event into a fixed size binary record and push it on a
+ * ring owned by their own thread, which never blocks: if the ring is full the
+ * record is dropped and counted.  A background thread empties every ring,
+ * formats the records and writes them out.
+ *
+ * Whether an event is logged at all is a single bit, so an event that is off
+ * costs one load and one branch.  Test it before building the arguments:
+ *
+ *     if (logger::on(logger::event::ATE)) {
+ *       logger::write(logger::event::ATE, tick, it->name(), at);
+ *     }
+ *
+ * Nothing is logged until start() is called.
+ */
+class logger {
+  public:
+    /**
+     * Groups of events, which can be turned on and off together.
+     */
+    enum class category : uint8_t { FIGHT, MATE, FOOD, STUN, STARVATION, WORKER };
+    static constexpr unsigned categories = 6;                   /**< the number of categories */
+    static constexpr unsigned all = (1u << categories) - 1;     /**< every category */
+
+    /**
+     * How much is logged: every level includes the ones before it.
+     */
+    enum class level : uint8_t { ERROR, INFO, DEBUG };
+
+    /**
+     * Everything that can be logged.
+     */
+    enum class event : uint8_t {
+      STONE,          /**< a critter ran into a stone and fell asleep; arg is the ticks asleep */
+      BABY,           /**< a baby was born at other_at */
+      NO_ROOM,        /**< two critters mated but had no room for a baby */
+      FIGHT,          /**< a fight; arg is a game::fight_results */
+      NOT_A_PLAYER,   /**< a critter fought something that isn't a player */
+      ATE,            /**< a critter ate */
+      STARVED,        /**< a critter starved */
+      WORKER_KILLED,  /**< the worker of a species was killed; arg is the signal */
+      WORKER_EXITED,  /**< the worker of a species exited; arg is its exit status */
+      WORKER_HUNG,    /**< the worker of a species didn't answer in time; arg is the seconds allowed */
+      WORKER_LOST,    /**< the worker of a species couldn't be reached; arg is the errno */
+    };
+
+    /**
+     * An event as it is kept on a ring.
+     */
+    struct record {
+      uint64_t tick;          /**< the tick it happened in */
+      event what;             /**< what happened */
+      uint8_t pad[3];
+      uint32_t arg;           /**< an event specific number */
+      point at;               /**< where it happened */
+      point other_at;         /**< where the other party was */
+      char who[20];           /**< the species it happened to, 0 terminated and cut short if need be */
+      char other[20];         /**< the other party, if any */
+    };
+    static_assert(sizeof(record) == 64, "a record should fill one cache line");
+
+    /**
+     * Determine if an event is logged.
+     */
+    static bool on(event e) {
+      return (mask_.load(std::memory_order_relaxed) >> unsigned(e)) & 1u;
+    }
+
+    /**
+     * Log an event, if there is room on the ring of this thread.
+     * @param e what happened
+     * @param tick the tick it happened in
+     * @param who the species it happened to
+     * @param at where
+     * @param other the other party, if any
+     * @param other_at where the other party was
+     * @param arg an event specific number
+     */
+    static void write(event e, unsigned long tick, const std::string& who, point at,
+                      const std::string& other = std::string(), point other_at = point(),
+                      uint32_t arg = 0);
+
+    /**
+     * Start logging, and the thread that writes the log.
+     * Does nothing if logging has started already.
+     * @param os where to write
+     * @param most the most detailed level logged
+     * @param which the categories logged, one bit for each, by position
+     */
+    static void start(std::ostream& os, level most, unsigned which = all);
+    /**
+     * Stop logging, write every record still on a ring, and stop the writing thread.
+     * Called at exit if it hasn't been called before.
+     */
+    static void stop();
+
+    /**
+     * Read a list of category names, such as fight,mate.
+     * @param list names separated by commas, or all
+     * @param which set to the categories, one bit for each
+     * @return false if a name is not a category
+     */
+    static bool parse(const std::string& list, unsigned& which);
+    /**
+     * @return the name of a category
+     */
+    static const char* name(category c);
+    /**
+     * @return the category of an event
+     */
+    static category category_of(event e);
+    /**
+     * @return the level of an event
+     */
+    static level level_of(event e);
+
+  private:
+    static inline std::atomic<uint32_t> mask_ {0};    /**< one bit for every event logged */
+};
+
+#endif
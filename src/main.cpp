@@ -1,8 +1,16 @@
 #include <unistd.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include <add_players.h>
 
@@ -20,9 +28,20 @@
 #include "food.h"
 #include "stone.h"
 
+#include "checkpoint.h"
+#include "control_socket.h"
 #include "game.h"
+#include "logger.h"
+#include "match_series.h"
+#include "recorder.h"
+#include "reference_critters.h"
+#include "sweep.h"
+#include "tracer.h"
 #include "view.h"
+#include "view_ansi.h"
 #include "view_curses.h"
+#include "view_export.h"
+#include "view_headless.h"
 
 using std::make_shared;
 using std::string;
@@ -33,7 +52,7 @@ using std::string;
  */
 static void show_usage(const string name)
 {
-  std::cerr << "Usage: " << name << " [-hd] [-f #] [-s #] [-n #] [-x #] [-y #]"
+  std::cerr << "Usage: " << name << " [-hdaH] [-g list] [-f #] [-s #] [-n #] [-x #] [-y #] [-t #] [-c path] [-o path] [-z #] [-r #] [-l layout] [-S path grid...] [-C dir] [-i #] [-k #] [-u] [-e path] [-E #] [-b list] [-w #] [-m name] [-M # [-A #]] [-p path [-P #]] [-X]"
 #ifdef WITH_SOLUTIONS
     << " [-LTBRWD]\n"
 #else
@@ -41,14 +60,69 @@ static void show_usage(const string name)
 #endif
     << "Options:\n"
     << "  -h   Show this text\n"
-    << "  -d   Enable debug output.\n"
+    << "  -d   Enable debug output: fights with stones, births and starvation.\n"
+    << "\t Repeat it, as -dd, for every fight and feeding as well.\n"
     << "\t Output is written to std::cerr.  Redirect accordingly, for example\n"
     << "\t a.out 2> debug.txt\n"
+    << "  -g   Limit debug output to a comma separated list of fight, mate, food, stun,\n"
+    << "\t starvation and worker.  Default = all.\n"
     << "  -f   Set the amount of Food on the board.  Default = 250.\n"
     << "  -s   Set the number of Stones on the board.  Default = 10.\n"
     << "  -n   Set the number of Critters for each Species.  Default = 25.\n"
     << "  -x   Set the world width.  Default = window width.\n"
     << "  -y   Set the world height.  Default = window height - space allocated for the score.\n"
+    << "  -a   Draw with plain ANSI escape sequences instead of ncurses.\n"
+    << "\t Sends far less to the terminal, which helps on large screens and slow links.\n"
+    << "  -H   Run headless: no display, no keyboard, and as fast as possible.\n"
+    << "\t The world defaults to 80x24.  Final scores are written to std::cout.\n"
+    << "  -t   Stop a headless run after # ticks.  Default = run until one species is left.\n"
+    << "  -o   Run headless and export every frame to path, for making videos.\n"
+    << "\t A path holding a printf pattern for the tick, such as frames/%06lu.ppm,\n"
+    << "\t writes one PPM image per frame.  Any other path gets a frame stream.\n"
+    << "  -z   Set the size of a tile in pixels in exported images.  Default = 4.\n"
+    << "  -r   Seed the random layout of the world and the simulator's random choices.\n"
+    << "\t Runs with the same seed and options play out the same way,\n"
+    << "\t unless the critters make random choices of their own.\n"
+    << "  -l   Arrange the world.  A comma separated list of:\n"
+    << "\t walls:   line stones up into walls\n"
+    << "\t patches: gather food into patches\n"
+    << "\t regions: start each species in its own part of the world\n"
+    << "\t Default = scatter everything at random.\n"
+    << "  -S   Sweep: run headless for every combination of the grid that follows,\n"
+    << "\t on all cores, appending one row per run to the CSV file at path.\n"
+    << "\t Runs already in the file are skipped, so a stopped sweep can be resumed.\n"
+    << "\t The grid is a list of name=values, where values is a number, a list\n"
+    << "\t such as 10,50, or a range such as 50:250:50.  Names are x, y, f, s, n,\n"
+    << "\t stone_sleep, mating_rest, and seeds for the number of seeds to try.\n"
+    << "\t Other options set the values not on the grid, -t the length of each run,\n"
+    << "\t and -r the first seed.  For example: -S out.csv -t 5000 f=50:250:50 seeds=10\n"
+    << "  -M   Play headless matches between the species, on all cores, until one is\n"
+    << "\t clearly the strongest or # matches are played, and report the win rates.\n"
+    << "\t Other options set the world, -t the length of each match, and -r the first seed.\n"
+    << "  -A   Set the chance a match series names the wrong winner.  Default = 0.05.\n"
+    << "  -C   Write checkpoints to the directory dir while the simulation runs.\n"
+    << "  -i   Set the number of ticks between checkpoints.  Default = 1000.\n"
+    << "  -k   Set the number of checkpoints to keep.  Default = 3.\n"
+    << "  -u   Pick up from the newest checkpoint in the -C directory, if there is one.\n"
+    << "\t The world size comes from the checkpoint; -x, -y, -f, -s, -n and -l are ignored.\n"
+    << "  -e   Record the counters of every species as the simulation runs, and write them\n"
+    << "\t to path.csv and, in a compact columnar form, path.crts when it stops.\n"
+    << "\t The 'e' key or command writes them while it runs.\n"
+    << "  -E   Set the number of ticks between recorded rows.  Default = 1.\n"
+    << "  -m   Publish the world after every tick to the POSIX shared memory segment name,\n"
+    << "\t such as /critters, for other processes to watch.  See src/shared_world.h.\n"
+    << "  -p   Trace what the engine spends its time on, tick by tick, and write the\n"
+    << "\t timeline to path when it stops, for chrome://tracing or ui.perfetto.dev.\n"
+    << "  -P   Set the most spans traced on each thread.  Default = 1000000.\n"
+    << "  -X   Run the code of each species in a worker process of its own,\n"
+    << "\t so a species that crashes or hangs forfeits instead of ending the game.\n"
+    << "\t Critters then see only their eight neighbors.  Not for -S or -M.\n"
+    << "  -b   Add reference critters, for benchmarks: a comma separated list of\n"
+    << "\t walker, seeker, fighter and coward, or all.\n"
+    << "\t Their random choices follow the seed, so runs with the same -r repeat.\n"
+    << "  -w   Make each move of a reference critter do # rounds of busy work.  Default = 0.\n"
+    << "  -c   Serve metrics and accept commands on a Unix domain socket at path.\n"
+    << "\t Send 'metrics' or 'stats' for metrics, or p, +, -, e or q as on the keyboard.\n"
     << "\n"
 #ifdef WITH_SOLUTIONS
     << "  -L   Add Lion to the simulation\n"
@@ -62,6 +136,52 @@ static void show_usage(const string name)
   exit(0);
 }
 
+/**
+ * Read a world layout from a comma separated list of options.
+ * @param text the list, for example "walls,patches"
+ * @param[out] shape the layout
+ * @return false if an option is not recognized
+ */
+static bool parse_layout(const string& text, layout& shape)
+{
+  std::size_t start = 0;
+  while (start <= text.size()) {
+    auto end = text.find(',', start);
+    if (end == string::npos) end = text.size();
+    auto option = text.substr(start, end - start);
+    if      (option == "walls")   shape.walls = true;
+    else if (option == "patches") shape.patches = true;
+    else if (option == "regions") shape.regions = true;
+    else return false;
+    start = end + 1;
+  }
+  return true;
+}
+
+/**
+ * Read the list of reference species to add.
+ * @param text a comma separated list of species names, or all
+ * @param[out] names the species names
+ * @return false if a name is not recognized
+ */
+static bool parse_references(const string& text, std::vector<string>& names)
+{
+  const auto known = reference_critter::names();
+  if (text == "all") {
+    names = known;
+    return true;
+  }
+  std::size_t start = 0;
+  while (start <= text.size()) {
+    auto end = text.find(',', start);
+    if (end == string::npos) end = text.size();
+    auto name = text.substr(start, end - start);
+    if (std::find(known.begin(), known.end(), name) == known.end()) return false;
+    names.push_back(name);
+    start = end + 1;
+  }
+  return true;
+}
 
 int main(int argc, char** argv) {
   int max_food = 50;
@@ -69,8 +189,13 @@ int main(int argc, char** argv) {
   int max_critters = 25;
 
   // screen ht and width.  0 means use current window size to comute x & y
+#if defined(CRITTERS_WORLD_WIDTH) && defined(CRITTERS_WORLD_HEIGHT)
+  int x = CRITTERS_WORLD_WIDTH;
+  int y = CRITTERS_WORLD_HEIGHT;
+#else
   int x = 0;
   int y = 0;
+#endif
 
 #ifdef WITH_SOLUTIONS
   bool use_lion = false;
@@ -83,11 +208,36 @@ int main(int argc, char** argv) {
 
   int c;
   int debug = 0;
+  unsigned log_categories = logger::all;
+  bool headless = false;
+  bool ansi = false;
+  unsigned long ticks = 0;
+  string control_path;
+  uint64_t seed = 0;
+  bool seeded = false;
+  layout shape;
+  string export_path;
+  string sweep_path;
+  string checkpoint_dir;
+  unsigned long checkpoint_every = 1000;
+  unsigned checkpoint_keep = 3;
+  bool resume = false;
+  string series_path;
+  std::vector<string> references;
+  string shared_name;
+  string trace_path;
+  bool isolated = false;
+  std::size_t trace_most = 1000000;
+  std::size_t series_max = 0;
+  double series_alpha = 0.05;
+  unsigned reference_work = 0;
+  unsigned long series_every = 1;
+  int cell_size = 4;
   string prog = argv[0];
 #ifdef WITH_SOLUTIONS
-  auto valid_args = "hdf:n:s:x:y:LTBRWD";
+  auto valid_args = "hdaHg:uf:n:s:t:x:y:c:o:z:r:l:S:C:i:k:e:E:b:w:m:M:A:p:P:XLTBRWD";
 #else
-  auto valid_args = "hdf:n:s:x:y:";
+  auto valid_args = "hdaHg:uf:n:s:t:x:y:c:o:z:r:l:S:C:i:k:e:E:b:w:m:M:A:p:P:X";
 #endif
 
   while ((c = getopt (argc, argv, valid_args)) != -1) {
@@ -96,7 +246,64 @@ int main(int argc, char** argv) {
         show_usage(prog);
         break;
       case 'd':
-        debug = 1;
+        ++debug;
+        break;
+      case 'X':
+        isolated = true;
+        break;
+      case 'p': trace_path = optarg;
+        break;
+      case 'P': trace_most = std::strtoul(optarg, nullptr, 10);
+        break;
+      case 'g':
+        if (!logger::parse(optarg, log_categories)) show_usage(prog);
+        break;
+      case 'a':
+        ansi = true;
+        break;
+      case 'H':
+        headless = true;
+        break;
+      case 'c': control_path = optarg;
+        break;
+      case 'o': export_path  = optarg;
+        break;
+      case 'S': sweep_path   = optarg;
+        break;
+      case 'C': checkpoint_dir = optarg;
+        break;
+      case 'i': checkpoint_every = std::strtoul(optarg, nullptr, 10);
+        break;
+      case 'k': checkpoint_keep  = unsigned(std::atoi(optarg));
+        break;
+      case 'u':
+        resume = true;
+        break;
+      case 'e': series_path  = optarg;
+        break;
+      case 'E': series_every = std::strtoul(optarg, nullptr, 10);
+        break;
+      case 'b':
+        if (!parse_references(optarg, references)) show_usage(prog);
+        break;
+      case 'w': reference_work = unsigned(std::atoi(optarg));
+        break;
+      case 'm': shared_name  = optarg;
+        break;
+      case 'M': series_max   = std::strtoul(optarg, nullptr, 10);
+        break;
+      case 'A': series_alpha = std::atof(optarg);
+        if (series_alpha <= 0 || series_alpha >= 1) show_usage(prog);
+        break;
+      case 'r': seed         = std::strtoull(optarg, nullptr, 10);
+        seeded = true;
+        break;
+      case 'l':
+        if (!parse_layout(optarg, shape)) show_usage(prog);
+        break;
+      case 'z': cell_size    = std::atoi(optarg);
+        break;
+      case 't': ticks        = std::strtoul(optarg, nullptr, 10);
         break;
       case 'f': max_food     = std::atoi(optarg);
         break;
@@ -136,27 +343,213 @@ int main(int argc, char** argv) {
     }
   }
 
-  game g;
+  if (isolated && (!sweep_path.empty() || series_max > 0)) {
+    std::cerr << "-X runs single games only; it can't be used with -S or -M.\n";
+    std::cerr << "Exiting.\n\n";
+    exit(-1);
+  }
 
-  g.set_view(std::unique_ptr<view>(new view_curses(x, y)));
-  g.set_debug(debug);
-  g.add_item(make_shared<stone>(),     max_stones);
-  g.add_item(make_shared<food>(),      max_food);
+  // errors are always logged; -d adds the rest
+  auto start_log = [&]() {
+    logger::start(std::cerr, debug == 0? logger::level::ERROR: debug == 1? logger::level::INFO: logger::level::DEBUG,
+                  log_categories);
+  };
+
+  if (!trace_path.empty()) {
+    try {
+      tracer::start(trace_path, trace_most);
+    } catch (const std::system_error& e) {
+      std::cerr << "Could not open the trace: " << e.what() << "\n";
+      std::cerr << "Exiting.\n\n";
+      exit(-1);
+    }
+  }
+
+  // makes a fresh critter of each species, for sweeps and match series
+  auto roster = [&](uint64_t run_seed) {
+    std::vector<std::shared_ptr<critter>> players;
+#ifdef WITH_SOLUTIONS
+    if (use_bear)     players.push_back(make_shared<bear>());
+    if (use_lion)     players.push_back(make_shared<lion>());
+    if (use_tiger)    players.push_back(make_shared<tiger>());
+    if (use_raccoon)  players.push_back(make_shared<raccoon>());
+    if (use_wombat)   players.push_back(make_shared<wombat>());
+    if (use_duck)     players.push_back(make_shared<duck>());
+#endif
+    for (const auto& name: references) {
+      players.push_back(reference_critter::make(name, {run_seed, reference_work}));
+    }
+    for (const auto& p: add_players()) {
+      players.push_back(p);
+    }
+    return players;
+  };
+  sweep::settings defaults = {{x == 0? 80: x, y == 0? 24: y, max_food, max_stones, max_critters,
+                               rules().stone_sleep, rules().mating_rest}};
+
+  if (!sweep_path.empty()) {
+    start_log();
+    try {
+      sweep runs(defaults, roster, shape, ticks, seeded? seed: 1);
+      for (int i = optind; i < argc; ++i) {
+        runs.add(argv[i]);
+      }
+      runs.run(sweep_path, std::thread::hardware_concurrency());
+    } catch (const std::exception& e) {
+      std::cerr << "Sweep failed: " << e.what() << "\n";
+      std::cerr << "Exiting.\n\n";
+      exit(-1);
+    }
+    tracer::stop();
+    return 0;
+  }
+
+  if (series_max > 0) {
+    start_log();
+    try {
+      match_series series(defaults, roster, shape, ticks, seeded? seed: 1);
+      std::cout << series.run(series_alpha, series_max, std::thread::hardware_concurrency());
+    } catch (const std::exception& e) {
+      std::cerr << "Match series failed: " << e.what() << "\n";
+      std::cerr << "Exiting.\n\n";
+      exit(-1);
+    }
+    tracer::stop();
+    return 0;
+  }
 
+  game g;
+  if (seeded) g.set_seed(seed);
+
+  std::vector<std::pair<std::shared_ptr<critter>, int>> players;
 #ifdef WITH_SOLUTIONS
-  if (use_bear)     g.add_item(make_shared<bear>(),    max_critters);
-  if (use_lion)     g.add_item(make_shared<lion>(),    max_critters);
-  if (use_tiger)    g.add_item(make_shared<tiger>(),   max_critters);
-  if (use_raccoon)  g.add_item(make_shared<raccoon>(), max_critters);
-  if (use_wombat)   g.add_item(make_shared<wombat>(),  max_critters);
-  if (use_duck)     g.add_item(make_shared<duck>(),    max_critters);
+  if (use_bear)     players.emplace_back(make_shared<bear>(),    max_critters);
+  if (use_lion)     players.emplace_back(make_shared<lion>(),    max_critters);
+  if (use_tiger)    players.emplace_back(make_shared<tiger>(),   max_critters);
+  if (use_raccoon)  players.emplace_back(make_shared<raccoon>(), max_critters);
+  if (use_wombat)   players.emplace_back(make_shared<wombat>(),  max_critters);
+  if (use_duck)     players.emplace_back(make_shared<duck>(),    max_critters);
 #endif
 
+  for (const auto& name: references) {
+    players.emplace_back(reference_critter::make(name, {g.seed(), reference_work}), max_critters);
+  }
   for (const auto& p: add_players()) {
-    g.add_item(p,  max_critters);
+    players.emplace_back(p,  max_critters);
+  }
+  // fork the species workers while this is the only thread,
+  // before the logger and the control socket start theirs
+  if (isolated) {
+    try {
+      g.isolate(players);
+    } catch (const std::exception& e) {
+      std::cerr << "Could not start the species workers: " << e.what() << "\n";
+      std::cerr << "Exiting.\n\n";
+      exit(-1);
+    }
   }
+  start_log();
 
-  g.start();
+  // open the socket before the screen is taken over, so errors can be seen
+  std::unique_ptr<control_socket> control;
+  if (!control_path.empty()) {
+    try {
+      control = std::make_unique<control_socket>(control_path);
+    } catch (const std::system_error& e) {
+      std::cerr << "Could not open control socket: " << e.what() << "\n";
+      std::cerr << "Exiting.\n\n";
+      exit(-1);
+    }
+  }
+
+  // likewise for the checkpoint directory, and the checkpoint to resume from
+  std::unique_ptr<checkpointer> checkpoints;
+  string saved;
+  if (!checkpoint_dir.empty()) {
+    try {
+      checkpoints = std::make_unique<checkpointer>(checkpoint_dir, checkpoint_keep);
+      if (resume) saved = checkpointer::latest(checkpoint_dir);
+    } catch (const std::system_error& e) {
+      std::cerr << "Could not use checkpoint directory: " << e.what() << "\n";
+      std::cerr << "Exiting.\n\n";
+      exit(-1);
+    }
+  }
+  std::ifstream saved_world;
+  if (!saved.empty()) {
+    try {
+      saved_world.open(saved, std::ios::binary);
+      checkpoint_in in(saved_world);
+      auto header = checkpoint_header::read(in);
+      x = header.width;
+      y = header.height;
+      saved_world.seekg(0);
+    } catch (const std::exception& e) {
+      std::cerr << "Could not resume from " << saved << ": " << e.what() << "\n";
+      std::cerr << "Exiting.\n\n";
+      exit(-1);
+    }
+  }
+
+  if (!export_path.empty()) {
+    headless = true;
+    try {
+      g.set_view(std::unique_ptr<view>(
+            new view_export(y == 0? 24: y, x == 0? 80: x, export_path, cell_size)));
+    } catch (const std::system_error& e) {
+      std::cerr << "Could not export frames: " << e.what() << "\n";
+      std::cerr << "Exiting.\n\n";
+      exit(-1);
+    }
+  } else if (headless) {
+    g.set_view(std::unique_ptr<view>(new view_headless(y == 0? 24: y, x == 0? 80: x)));
+  } else if (ansi) {
+    g.set_view(std::unique_ptr<view>(new view_ansi(y, x)));
+  } else {
+    g.set_view(std::unique_ptr<view>(new view_curses(y, x)));
+  }
+  g.set_debug(debug);
+  if (control) g.set_control(std::move(control));
+  if (debug != 0) std::cerr << "seed: " << g.seed() << "\n";
+
+  if (saved.empty()) {
+    g.generate(max_stones, max_food, players, shape);
+  } else {
+    std::vector<std::shared_ptr<critter>> roster;
+    for (const auto& p: players) {
+      roster.push_back(p.first);
+    }
+    try {
+      g.load(saved_world, roster);
+    } catch (const std::runtime_error& e) {
+      std::cerr << "Could not resume from " << saved << ": " << e.what() << "\n";
+      std::cerr << "Exiting.\n\n";
+      exit(-1);
+    }
+    if (debug != 0) std::cerr << "resumed from " << saved << "\n";
+  }
+  if (checkpoints) g.set_checkpoints(std::move(checkpoints), checkpoint_every);
+  if (!shared_name.empty()) {
+    try {
+      g.set_shared(shared_name);
+    } catch (const std::system_error& e) {
+      std::cerr << "Could not publish the world: " << e.what() << "\n";
+      std::cerr << "Exiting.\n\n";
+      exit(-1);
+    }
+  }
+  if (!series_path.empty()) {
+    // a headless run of known length records a known number of rows
+    auto rows = headless && ticks > g.ticks()? (ticks - g.ticks()) / std::max(1ul, series_every) + 1: 0;
+    g.set_recorder(std::make_unique<recorder>(series_path, series_every, rows));
+  }
+
+  if (headless) {
+    g.run(ticks);
+  } else {
+    g.start();
+  }
+  tracer::stop();
   return 0;
 }
 
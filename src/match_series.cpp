@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+#include "game.h"
+#include "match_series.h"
+#include "view_headless.h"
+
+namespace {
+  // positions of the parameters in sweep::names
+  enum { X, Y, FOOD, STONES, CRITTERS, STONE_SLEEP, MATING_REST };
+
+  // the mixing parameter of the boundary: it is tightest after about 1/rho matches
+  constexpr double rho = 0.05;
+
+  // marks a match in the results that hasn't finished
+  constexpr int unplayed = -2;
+  // marks a match in the results that ended in a draw
+  constexpr int draw = -1;
+} // end anonymous namespace
+
+match_series::match_series(const sweep::settings& world, sweep::roster players, const layout& shape,
+                           unsigned long ticks, uint64_t first_seed)
+  : world_(world)
+  , players_(std::move(players))
+  , shape_(shape)
+  , ticks_(ticks)
+  , first_seed_(first_seed)
+{
+  // the game keeps its scores sorted by name, and so does the report
+  std::set<std::string> species;
+  for (const auto& c: players_(first_seed_)) {
+    species.insert(c->name());
+  }
+  species_.assign(species.begin(), species.end());
+  if (species_.size() < 2) {
+    throw std::invalid_argument("a match needs at least two species");
+  }
+  auto items = world_[FOOD] + world_[STONES] + world_[CRITTERS] * long(species_.size());
+  if (items > world_[X] * world_[Y]) {
+    throw std::invalid_argument(std::to_string(items) + " items don't fit in a " +
+                                std::to_string(world_[X]) + 'x' + std::to_string(world_[Y]) + " world");
+  }
+}
+
+double match_series::half_width(std::size_t n, double alpha) {
+  // |mean - p| stays within this for every n at once, with probability 1 - 2 alpha,
+  // for outcomes between 0 and 1 (sub-Gaussian with variance 1/4)
+  const auto v = double(n) * rho + 1;
+  return std::sqrt(0.5 * v / (double(n) * double(n) * rho) * std::log(std::sqrt(v) / alpha));
+}
+
+match_series::result match_series::run(double alpha, std::size_t max_matches, unsigned threads) const {
+  const auto k = species_.size();
+  const auto side_alpha = alpha / (2.0 * double(k));
+
+  result r;
+  for (const auto& name: species_) {
+    r.species.push_back({name});
+  }
+  // fill in the estimates after n matches, and name a winner if one is clear
+  auto estimate = [&](std::size_t n) {
+    const auto h = half_width(n, side_alpha);
+    for (auto& s: r.species) {
+      s.rate = double(s.wins) / double(n);
+      s.low = std::max(0.0, s.rate - h);
+      s.high = std::min(1.0, s.rate + h);
+    }
+    for (const auto& s: r.species) {
+      if (std::all_of(r.species.begin(), r.species.end(),
+            [&s](const result::record& o) { return &o == &s || s.low > o.high; })) {
+        r.winner = s.name;
+      }
+    }
+  };
+
+  std::vector<int> winners(max_matches, unplayed);
+  std::atomic<std::size_t> next {0};
+  std::atomic<bool> decided {false};
+  std::mutex lock;      // guards winners, r and failure
+  std::exception_ptr failure;
+
+  threads = std::max(1u, std::min(threads, unsigned(max_matches)));
+  std::cerr << "Series: up to " << max_matches << " matches of " << k << " species on "
+            << threads << " threads, alpha " << alpha << ".\n";
+
+  auto worker = [&]() {
+    game g;
+    g.set_view(std::make_unique<view_headless>(int(world_[Y]), int(world_[X])));
+    bool fresh = true;
+    for (auto i = next++; i < max_matches && !decided; i = next++) {
+      try {
+        if (!fresh) g.reset();
+        fresh = false;
+        g.set_seed(first_seed_ + i);
+        g.set_rules(rules {int(world_[STONE_SLEEP]), int(world_[MATING_REST])});
+        std::vector<std::pair<std::shared_ptr<critter>, int>> players;
+        for (auto& c: players_(first_seed_ + i)) {
+          players.emplace_back(std::move(c), int(world_[CRITTERS]));
+        }
+        g.generate(int(world_[STONES]), int(world_[FOOD]), players, shape_);
+        g.play(ticks_);
+
+        // species_ and the scores are both sorted by name
+        int winner = draw;
+        unsigned best = 0;
+        int at = 0;
+        for (const auto& s: g.scores()) {
+          auto index = int(std::lower_bound(species_.begin(), species_.end(), s.first) - species_.begin());
+          auto score = s.second->score();
+          if (at == 0 || score > best) {
+            winner = index;
+            best = score;
+          } else if (score == best) {
+            winner = draw;
+          }
+          ++at;
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        winners[i] = winner;
+        // take results in seed order, so the stopping point doesn't depend on timing
+        while (!decided && r.matches < max_matches && winners[r.matches] != unplayed) {
+          auto w = winners[r.matches++];
+          if (w == draw) ++r.draws;
+          else ++r.species[std::size_t(w)].wins;
+          estimate(r.matches);
+          if (!r.winner.empty()) decided = true;
+        }
+        std::cerr << '\r' << r.matches << '/' << max_matches << " matches" << std::flush;
+      } catch (...) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!failure) failure = std::current_exception();
+        decided = true;   // stop handing out matches
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; ++t) {
+    workers.emplace_back(worker);
+  }
+  for (auto& w: workers) {
+    w.join();
+  }
+  std::cerr << '\n';
+  if (failure) std::rethrow_exception(failure);
+  return r;
+}
+
+std::ostream& operator<<(std::ostream& os, const match_series::result& r) {
+  if (r.winner.empty()) {
+    os << "No clear winner after " << r.matches << " matches.\n";
+  } else {
+    os << r.winner << " wins after " << r.matches << " matches.\n";
+  }
+  os << "draws " << r.draws << '\n';
+  for (const auto& s: r.species) {
+    os << s.name << " wins " << s.wins << ", win rate " << std::fixed << std::setprecision(3)
+       << s.rate << " [" << s.low << ", " << s.high << "]\n" << std::defaultfloat;
+  }
+  return os;
+}
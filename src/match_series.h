@@ -0,0 +1,103 @@
+#ifndef MESA_CRITTERS_MATCH_SERIES_H
+#define MESA_CRITTERS_MATCH_SERIES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "sweep.h"
+#include "world_generator.h"
+
+/**
+ * Plays headless matches between species until one is clearly the strongest.
+ *
+ * Match i uses seed first_seed + i, so any match can be replayed with critters -H -r.
+ * The winner of a match is the species with the highest score when it ends;
+ * a match where two species share the highest score is a draw.
+ *
+ * After every match, the win rate of each species is estimated with a
+ * confidence sequence: an interval that holds the true win rate at every match
+ * count at once with probability 1 - alpha, so the series can stop as soon as
+ * the answer is clear without inflating the error rate, as repeatedly checking
+ * an ordinary confidence interval would.  The intervals use the normal mixture
+ * boundary of Robbins for a bounded outcome, split evenly over both sides of
+ * every species.  The series stops when the lower end of one species' interval
+ * is above the upper end of every other, or after the most matches allowed.
+ *
+ * Matches are played several at once, but results are taken in seed order,
+ * so a series stops after the same matches however many threads play it.
+ */
+class match_series {
+  public:
+    /**
+     * How a series ended.
+     */
+    struct result {
+      /**
+       * The record of one species.
+       */
+      struct record {
+        std::string name;       /**< the species */
+        std::size_t wins = 0;   /**< matches won */
+        double rate = 0;        /**< wins per match */
+        double low = 0;         /**< lower end of the confidence interval of the win rate */
+        double high = 1;        /**< upper end of the confidence interval of the win rate */
+      };
+      std::size_t matches = 0;          /**< matches used */
+      std::size_t draws = 0;            /**< matches without a single winner */
+      std::string winner;               /**< the species found strongest, or empty if none was */
+      std::vector<record> species;      /**< every species, by name */
+    };
+
+    /**
+     * Create a series.
+     * @param world the world every match is played in, as for a sweep
+     * @param players makes the species for a match; at least two
+     * @param shape how to arrange each world
+     * @param ticks stop each match after this many ticks,
+     *        or 0 to play until one species is left
+     * @param first_seed the seed of the first match
+     * @throws std::invalid_argument if there are fewer than two species,
+     *         or they don't fit in the world
+     */
+    match_series(const sweep::settings& world, sweep::roster players, const layout& shape,
+                 unsigned long ticks, uint64_t first_seed);
+
+    /**
+     * Play matches until one species is clearly the strongest.
+     * Progress is reported on std::cerr.
+     * @param alpha the chance of naming a winner that isn't the strongest, between 0 and 1
+     * @param max_matches the most matches to play
+     * @param threads the number of matches to play at once
+     * @return how the series ended
+     */
+    result run(double alpha, std::size_t max_matches, unsigned threads) const;
+
+    /**
+     * Find the half width of the confidence interval of a win rate.
+     * @param n the number of matches
+     * @param alpha the chance the interval misses, on one side, at any match count
+     * @return the half width
+     */
+    static double half_width(std::size_t n, double alpha);
+
+  private:
+    sweep::settings world_;           /**< the world of every match */
+    sweep::roster players_;           /**< makes the species for a match */
+    layout shape_;                    /**< how each world is arranged */
+    unsigned long ticks_;             /**< ticks per match, or 0 to play each out */
+    uint64_t first_seed_;             /**< seed of the first match */
+    std::vector<std::string> species_;  /**< species names, sorted */
+};
+
+/**
+ * Insert a summary of a series into an output stream.
+ * @param os reference to an output stream
+ * @param r the series result
+ * @return the modified output stream
+ */
+std::ostream& operator<<(std::ostream& os, const match_series::result& r);
+
+#endif
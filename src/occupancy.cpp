@@ -0,0 +1,183 @@
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#endif
+
+#include "occupancy.h"
+
+namespace {
+
+  inline std::size_t popcount(uint64_t w) {
+    return std::size_t(__builtin_popcountll(w));
+  }
+
+  // Count the set bits in a run of whole words.
+  // With AVX2, 4 words at a time are counted with a nibble lookup table (Mula's method);
+  // otherwise, one word at a time with the hardware popcount, if there is one.
+  std::size_t popcount(const uint64_t* w, std::size_t n) {
+    std::size_t total = 0;
+    std::size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i lookup = _mm256_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0f);
+    __m256i acc = _mm256_setzero_si256();
+    for (; i + 4 <= n; i += 4) {
+      auto v  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w + i));
+      auto lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low));
+      auto hi = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+      acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+    }
+    total += std::size_t(_mm256_extract_epi64(acc, 0)) + std::size_t(_mm256_extract_epi64(acc, 1))
+           + std::size_t(_mm256_extract_epi64(acc, 2)) + std::size_t(_mm256_extract_epi64(acc, 3));
+#endif
+    for (; i < n; ++i) {
+      total += popcount(w[i]);
+    }
+    return total;
+  }
+
+  inline uint64_t low_bits(std::size_t n) {
+    return n >= 64? ~uint64_t(0): (uint64_t(1) << n) - 1;
+  }
+
+  inline int wrap(int v, int limit) {
+    v %= limit;
+    return v < 0? v + limit: v;
+  }
+
+} // end anonymous namespace
+
+bitboard::bitboard(std::size_t slots)
+  : words_(((slots + 255) / 256) * 4, 0)
+{}
+
+std::size_t bitboard::count() const {
+  return popcount(words_.data(), words_.size());
+}
+
+std::size_t bitboard::count(std::size_t first, std::size_t n) const {
+  if (n == 0) return 0;
+  auto w0 = first / 64;
+  auto w1 = (first + n - 1) / 64;
+  auto shift = first % 64;
+  if (w0 == w1) {
+    return popcount((words_[w0] >> shift) & low_bits(n));
+  }
+  auto total = popcount(words_[w0] >> shift);
+  total += popcount(words_.data() + w0 + 1, w1 - w0 - 1);
+  total += popcount(words_[w1] & low_bits((first + n - 1) % 64 + 1));
+  return total;
+}
+
+std::size_t bitboard::select(std::size_t k) const {
+  for (std::size_t w = 0; w < words_.size(); ++w) {
+    auto bits = words_[w];
+    auto c = popcount(bits);
+    if (k >= c) {
+      k -= c;
+      continue;
+    }
+    for (; k > 0; --k) {
+      bits &= bits - 1;    // drop the lowest set bit
+    }
+    return w * 64 + std::size_t(__builtin_ctzll(bits));
+  }
+  assert (false && "select past the end of a bitboard");
+  return std::numeric_limits<std::size_t>::max();
+}
+
+void occupancy::reset(const world_geometry* geom) {
+  assert (geom != nullptr);
+  geom_ = geom;
+  ++version_;
+  // everything changed; a reader behind this version starts over
+  changes_.clear();
+  remembered_ = std::max<std::size_t>(geom_->size() / 4, 64);
+  forgotten_ = version_;
+  kinds_.assign(geom_->size(), EMPTY);
+  boards_.assign(FIRST_SPECIES, bitboard(geom_->size()));
+  names_ = { {"Empty", EMPTY}, {"Food", FOOD}, {"Stone", STONE} };
+  geom_->for_each([this](std::size_t i) {
+    boards_[EMPTY].set(i);
+  });
+}
+
+occupancy::kind occupancy::kind_of(const critter& it) {
+  auto name = it.name();
+  if (auto k = names_.find(name); k != names_.end()) {
+    return k->second;
+  }
+  assert (it.is_player());
+  assert (boards_.size() <= std::numeric_limits<kind>::max());
+  auto k = kind(boards_.size());
+  boards_.emplace_back(geom_->size());
+  names_[name] = k;
+  return k;
+}
+
+bool occupancy::lookup(const std::string& name, kind& k) const {
+  auto found = names_.find(name);
+  if (found == names_.end()) return false;
+  k = found->second;
+  return true;
+}
+
+void occupancy::set(std::size_t p, kind k) {
+  boards_[kinds_[p]].reset(p);
+  boards_[k].set(p);
+  kinds_[p] = k;
+  changed(p);
+}
+
+void occupancy::swap(std::size_t a, std::size_t b) {
+  auto ka = kinds_[a];
+  auto kb = kinds_[b];
+  if (ka == kb) return;
+  boards_[ka].reset(a);
+  boards_[ka].set(b);
+  boards_[kb].reset(b);
+  boards_[kb].set(a);
+  std::swap(kinds_[a], kinds_[b]);
+  changed(a);
+  changed(b);
+}
+
+void occupancy::changed(std::size_t p) {
+  // past a quarter of the world, starting over is as cheap as catching up
+  if (changes_.size() >= remembered_) {
+    changes_.clear();
+    forgotten_ = version_;
+  }
+  changes_.push_back(p);
+  ++version_;
+}
+
+std::size_t occupancy::count_row(kind k, int y, int x0, int n) const {
+  const int width = geom_->width();
+  n = std::min(n, width);
+  if (n <= 0) return 0;
+  x0 = wrap(x0, width);
+  auto row = geom_->index(point(0, int16_t(wrap(y, geom_->height()))));
+  const auto& board = boards_[k];
+  if (x0 + n <= width) {
+    return board.count(row + x0, n);
+  }
+  return board.count(row + x0, width - x0) + board.count(row, x0 + n - width);
+}
+
+std::size_t occupancy::count(kind k, int x0, int y0, int x1, int y1) const {
+  const int rows = std::min(y1 - y0 + 1, int(geom_->height()));
+  std::size_t total = 0;
+  for (int r = 0; r < rows; ++r) {
+    total += count_row(k, y0 + r, x0, x1 - x0 + 1);
+  }
+  return total;
+}
+
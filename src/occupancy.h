@@ -0,0 +1,232 @@
+#ifndef MESA_CRITTERS_OCCUPANCY_H
+#define MESA_CRITTERS_OCCUPANCY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "critter.h"
+#include "geometry.h"
+
+/**
+ * A packed set of tiles, one bit per storage slot of a world geometry.
+ * Each row of the world occupies a contiguous run of bits,
+ * so counting the members of a row or rectangle is a run of popcounts.
+ */
+class bitboard {
+  public:
+    /**
+     * Create an empty bitboard.
+     * @param slots the number of storage slots to cover
+     */
+    explicit bitboard(std::size_t slots = 0);
+
+    /**
+     * @return true if slot i is in the set
+     */
+    bool test(std::size_t i) const { return (words_[i / 64] >> (i % 64)) & 1u; }
+    /**
+     * Add slot i to the set.
+     */
+    void set(std::size_t i) { words_[i / 64] |= uint64_t(1) << (i % 64); }
+    /**
+     * Remove slot i from the set.
+     */
+    void reset(std::size_t i) { words_[i / 64] &= ~(uint64_t(1) << (i % 64)); }
+
+    /**
+     * @return the number of slots in the set
+     */
+    std::size_t count() const;
+    /**
+     * Count the members of a contiguous run of slots.
+     * @param first the first slot in the run
+     * @param n the length of the run
+     * @return the number of slots in [first, first + n) that are in the set
+     */
+    std::size_t count(std::size_t first, std::size_t n) const;
+    /**
+     * Find a member of the set by rank.
+     * @param k the rank, which must be less than count()
+     * @return the slot of the k-th member, counting from slot 0
+     */
+    std::size_t select(std::size_t k) const;
+
+    /**
+     * Visit every member of the set in slot order.
+     * @param f a callable taking a std::size_t
+     */
+    template <class F>
+    void for_each(F&& f) const {
+      for (std::size_t w = 0; w < words_.size(); ++w) {
+        for (auto bits = words_[w]; bits != 0; bits &= bits - 1) {
+          f(w * 64 + std::size_t(__builtin_ctzll(bits)));
+        }
+      }
+    }
+    /**
+     * Visit every member of the set that is not in another set, in slot order.
+     * @param mask the members to skip; must cover the same slots
+     * @param f a callable taking a std::size_t
+     */
+    template <class F>
+    void for_each_except(const bitboard& mask, F&& f) const {
+      for (std::size_t w = 0; w < words_.size(); ++w) {
+        for (auto bits = words_[w] & ~mask.words_[w]; bits != 0; bits &= bits - 1) {
+          f(w * 64 + std::size_t(__builtin_ctzll(bits)));
+        }
+      }
+    }
+
+  private:
+    std::vector<uint64_t> words_;   /**< the bits, padded to whole SIMD blocks */
+};
+
+/**
+ * Tracks what kind of thing occupies every tile of the world.
+ *
+ * Every tile holds exactly one kind: empty, food, stone or a member of a species.
+ * There is one bitboard per kind, so a change of occupant flips one bit on
+ * the old kind's board and one on the new kind's.
+ */
+class occupancy {
+  public:
+    /**
+     * Identifies the kind of occupant of a tile.
+     * Species are numbered after the fixed kinds, in the order they first appear.
+     */
+    using kind = uint8_t;
+
+    static constexpr kind EMPTY = 0;       /**< an unoccupied tile */
+    static constexpr kind FOOD = 1;        /**< a tile holding food */
+    static constexpr kind STONE = 2;       /**< a tile holding a stone */
+    static constexpr kind FIRST_SPECIES = 3;  /**< the kind of the first species */
+
+    /**
+     * Discard everything and start over with every tile of a new world empty.
+     * @param geom the geometry of the world.  Must outlive this object.
+     */
+    void reset(const world_geometry* geom);
+
+    /**
+     * Find the kind of an entity, registering a new species if needed.
+     * @param it the entity
+     * @return the kind of it
+     */
+    kind kind_of(const critter& it);
+    /**
+     * Find the kind with a name.
+     * @param name "Empty", "Food", "Stone" or the name of a species
+     * @param[out] k the kind, if the name is known
+     * @return false if there is no kind with this name
+     */
+    bool lookup(const std::string& name, kind& k) const;
+
+    /**
+     * @return the number of kinds, including every species seen so far
+     */
+    std::size_t kinds() const { return boards_.size(); }
+
+    /**
+     * @return the kind of the occupant of a tile
+     */
+    kind at(std::size_t p) const { return kinds_[p]; }
+    /**
+     * Change the kind of the occupant of a tile.
+     */
+    void set(std::size_t p, kind k);
+    /**
+     * Exchange the occupants of two tiles.
+     */
+    void swap(std::size_t a, std::size_t b);
+    /**
+     * @return a number that grows by one for every tile whose occupant changes
+     */
+    uint64_t version() const { return version_; }
+    /**
+     * Visit every tile whose occupant has changed since an earlier version,
+     * oldest change first.  A tile changed more than once is visited more than once.
+     * Only the most recent changes are remembered, and none from before the last reset().
+     * @param since the version the caller last looked at
+     * @param f a callable taking a std::size_t
+     * @return false, having visited nothing, if the changes since then are no longer remembered
+     */
+    template <class F>
+    bool changes_since(uint64_t since, F&& f) const {
+      if (since < forgotten_ || since > version_) return false;
+      for (auto i = std::size_t(since - forgotten_); i < changes_.size(); ++i) {
+        f(changes_[i]);
+      }
+      return true;
+    }
+
+    /**
+     * @return the number of tiles holding a kind
+     */
+    std::size_t count(kind k) const { return boards_[k].count(); }
+    /**
+     * Count the tiles holding a kind in part of a row.
+     * The run wraps around the world edge, and is clipped to one full row.
+     * @param k the kind
+     * @param y the row
+     * @param x0 the first column
+     * @param n the number of columns
+     * @return the number of matching tiles
+     */
+    std::size_t count_row(kind k, int y, int x0, int n) const;
+    /**
+     * Count the tiles holding a kind in a rectangle.
+     * The rectangle wraps around the world edges, and is clipped to the world size.
+     * @param k the kind
+     * @param x0 the left column
+     * @param y0 the top row
+     * @param x1 the right column, inclusive
+     * @param y1 the bottom row, inclusive
+     * @return the number of matching tiles
+     */
+    std::size_t count(kind k, int x0, int y0, int x1, int y1) const;
+    /**
+     * Find a tile holding a kind by rank, in storage order.
+     * @param k the kind
+     * @param n the rank, which must be less than count(k)
+     * @return the slot of the tile
+     */
+    std::size_t select(kind k, std::size_t n) const { return boards_[k].select(n); }
+    /**
+     * Visit every tile holding a kind, in storage order.
+     * @param k the kind
+     * @param f a callable taking a std::size_t
+     */
+    template <class F>
+    void for_each(kind k, F&& f) const { boards_[k].for_each(std::forward<F>(f)); }
+    /**
+     * Visit every tile holding a kind that is not in a set, in storage order.
+     * @param k the kind
+     * @param mask the tiles to skip
+     * @param f a callable taking a std::size_t
+     */
+    template <class F>
+    void for_each_except(kind k, const bitboard& mask, F&& f) const {
+      boards_[k].for_each_except(mask, std::forward<F>(f));
+    }
+
+  private:
+    const world_geometry* geom_ = nullptr;                /**< geometry of the world */
+    std::vector<kind> kinds_;                             /**< kind of the occupant, per slot */
+    std::vector<bitboard> boards_;                        /**< one board per kind */
+    std::unordered_map<std::string, kind> names_;         /**< kind of each name */
+    uint64_t version_ = 1;                                /**< counts changes of occupant */
+    std::vector<std::size_t> changes_;                    /**< the tiles changed since version forgotten_ */
+    uint64_t forgotten_ = 1;                              /**< the oldest version changes_ reaches back to */
+    std::size_t remembered_ = 0;                          /**< the most changes kept */
+
+    /**
+     * Remember that the occupant of a tile changed.
+     */
+    void changed(std::size_t p);
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <system_error>
+
+#include "checkpoint.h"
+#include "recorder.h"
+
+const std::array<const char*, recorder::counters> recorder::counter_names = {{
+  "alive", "dead", "kills", "feedings", "starved"
+}};
+
+recorder::recorder(const std::string& path, unsigned long every, std::size_t rows)
+  : path_(path)
+  , every_(std::max(1ul, every))
+  , reserve_(rows)
+{
+  ticks_.reserve(reserve_);
+}
+
+void recorder::track(const std::map<std::string, std::shared_ptr<species>>& players, unsigned long tick) {
+  species_.clear();
+  names_.clear();
+  for (const auto& p : players) {
+    species_.push_back(p.second.get());
+    for (auto counter : counter_names) {
+      names_.push_back(p.first + '.' + counter);
+    }
+  }
+  ticks_.clear();
+  columns_.assign(names_.size(), {});
+  for (auto& column : columns_) {
+    column.reserve(reserve_);
+  }
+  next_ = tick;
+}
+
+void recorder::write() const {
+  auto save = [](const std::string& path, auto&& write) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (out) {
+      write(out);
+      out.close();
+    }
+    if (!out) throw std::system_error(errno, std::generic_category(), path);
+  };
+  save(path_ + ".csv", [this](std::ostream& out) { write_csv(out); });
+  save(path_ + ".crts", [this](std::ostream& out) { write_columns(out); });
+}
+
+void recorder::finish() const {
+  try {
+    write();
+    std::cerr << "Wrote " << rows() << " rows of species counters to "
+              << path_ << ".csv and " << path_ << ".crts.\n";
+  } catch (const std::system_error& e) {
+    std::cerr << "Can't write the species counters: " << e.what() << '\n';
+  }
+}
+
+void recorder::write_csv(std::ostream& out) const {
+  out << "tick";
+  for (const auto& name : names_) {
+    out << ',' << name;
+  }
+  out << '\n';
+  for (std::size_t row = 0; row < ticks_.size(); ++row) {
+    out << ticks_[row];
+    for (const auto& column : columns_) {
+      out << ',' << column[row];
+    }
+    out << '\n';
+  }
+}
+
+void recorder::write_columns(std::ostream& out) const {
+  checkpoint_out w(out);
+  w.bytes("CRTS", 4);
+  w.u8(1);
+  w.u32(uint32_t(columns_.size() + 1));
+  w.u64(ticks_.size());
+  w.str("tick");
+  w.u8(8);
+  for (auto t : ticks_) {
+    w.u64(t);
+  }
+  for (std::size_t c = 0; c < columns_.size(); ++c) {
+    w.str(names_[c]);
+    w.u8(4);
+    for (auto v : columns_[c]) {
+      w.u32(v);
+    }
+  }
+}
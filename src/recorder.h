@@ -0,0 +1,116 @@
+#ifndef MESA_CRITTERS_RECORDER_H
+#define MESA_CRITTERS_RECORDER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "species.h"
+
+/**
+ * Records the counters of every species over time, one row every so many ticks.
+ *
+ * Each counter of each species is a column of its own, kept in an append buffer
+ * reserved up front when the length of the run is known, so recording a row is
+ * a handful of stores.
+ *
+ * The series is written as two files:
+ * a CSV file with a header row, and a binary columnar file
+ *
+ *     header:  "CRTS", u8 version (1), u32 number of columns, u64 number of rows
+ *     column:  u32 name length, name, u8 bytes per value, then every value
+ *
+ * with all numbers little endian.  The first column is the tick, 8 bytes per
+ * value; the rest are <species>.<counter>, 4 bytes per value.
+ */
+class recorder {
+  public:
+    /**
+     * The number of counters recorded for each species.
+     */
+    static constexpr std::size_t counters = 5;
+    /**
+     * The name of each counter, in column order.
+     */
+    static const std::array<const char*, counters> counter_names;
+
+    /**
+     * Start a recording.
+     * @param path where to write, without an extension.
+     *        The files written are path.csv and path.crts.
+     * @param every the number of ticks between rows
+     * @param rows the number of rows to make room for up front, if known
+     */
+    recorder(const std::string& path, unsigned long every, std::size_t rows = 0);
+
+    /**
+     * Start recording a new set of species, discarding any rows so far.
+     * @param players the species, keyed by name.  They must outlive the recording.
+     * @param tick the current tick, which gets the first row
+     */
+    void track(const std::map<std::string, std::shared_ptr<species>>& players, unsigned long tick);
+
+    /**
+     * Record every row due up to a tick.
+     * The counters can't have changed since the last call,
+     * so rows skipped over by a jump in the tick get the current values.
+     * @param tick the current tick
+     */
+    void record(unsigned long tick) {
+      for (; next_ <= tick; next_ += every_) {
+        ticks_.push_back(next_);
+        auto column = columns_.begin();
+        for (const auto* s : species_) {
+          (column++)->push_back(s->alive());
+          (column++)->push_back(s->dead());
+          (column++)->push_back(s->kills());
+          (column++)->push_back(s->feedings());
+          (column++)->push_back(s->starved());
+        }
+      }
+    }
+
+    /**
+     * @return the number of rows recorded
+     */
+    std::size_t rows() const { return ticks_.size(); }
+    /**
+     * @return the number of species being recorded
+     */
+    std::size_t tracked() const { return species_.size(); }
+
+    /**
+     * Write everything recorded so far to path.csv and path.crts.
+     * @throws std::system_error if a file can't be written
+     */
+    void write() const;
+    /**
+     * Write everything recorded, and report what was written.
+     */
+    void finish() const;
+    /**
+     * Write everything recorded so far as CSV.
+     */
+    void write_csv(std::ostream& out) const;
+    /**
+     * Write everything recorded so far in the binary columnar format.
+     */
+    void write_columns(std::ostream& out) const;
+
+  private:
+    std::string path_;                      /**< where to write, without an extension */
+    unsigned long every_;                   /**< ticks between rows */
+    std::size_t reserve_;                   /**< rows to make room for */
+    unsigned long next_ = 0;                /**< the tick of the next row */
+    std::vector<const species*> species_;   /**< the species, in name order */
+    std::vector<std::string> names_;        /**< the name of each column after the tick */
+    std::vector<uint64_t> ticks_;           /**< the tick of each row */
+    std::vector<std::vector<uint32_t>> columns_;  /**< every counter of every species */
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "reference_critters.h"
+
+namespace {
+  /**
+   * Scramble a 64 bit value; the finalizer of splitmix64.
+   */
+  uint64_t mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+
+  /**
+   * Hash a name; FNV-1a, so seeds mean the same on every platform.
+   */
+  uint64_t hash(const std::string& name) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (auto c : name) {
+      h = (h ^ uint8_t(c)) * 0x100000001b3ull;
+    }
+    return h;
+  }
+
+  /**
+   * Where the busy work is left, so it can't be optimized away.
+   */
+  volatile uint64_t sink;
+} // end anonymous namespace
+
+reference_critter::reference_critter(const std::string& name, const config& c)
+  : critter(name)
+  , config_(c)
+  , state_(mix(c.seed ^ hash(name)))
+{ }
+
+uint64_t reference_critter::next() {
+  state_ += 0x9e3779b97f4a7c15ull;
+  return mix(state_);
+}
+
+reference_critter::config reference_critter::spawn() {
+  auto c = config_;
+  c.seed = next();
+  return c;
+}
+
+void reference_critter::think() {
+  auto x = state_;
+  for (unsigned i = 0; i < config_.work; ++i) {
+    x = mix(x + i);
+  }
+  sink = x;
+}
+
+critter::attack reference_critter::fight([[maybe_unused]] const std::string& opponent) {
+  return attacks[pick(3)];
+}
+
+direction reference_critter::wander(const std::map<direction, std::shared_ptr<critter>>& neighbors) {
+  direction open[8];
+  unsigned n = 0;
+  for (const auto& tile : neighbors) {
+    if (tile.second->name() != "Stone" && tile.second->name() != name()) open[n++] = tile.first;
+  }
+  return n == 0? direction::CENTER: open[pick(n)];
+}
+
+bool reference_critter::is_enemy(const std::shared_ptr<critter>& it) const {
+  return it->is_player() && it->name() != name();
+}
+
+direction walker::move(const std::map<direction, std::shared_ptr<critter>>& neighbors) {
+  think();
+  return wander(neighbors);
+}
+
+direction seeker::survey(const std::map<direction, std::shared_ptr<critter>>& neighbors,
+                         const perception& sight) {
+  think();
+  for (const auto& tile : neighbors) {
+    if (tile.second->name() == "Food") return tile.first;
+  }
+  auto d = sight.toward_food();
+  return d == direction::CENTER? wander(neighbors): d;
+}
+
+direction fighter::survey(const std::map<direction, std::shared_ptr<critter>>& neighbors,
+                          const perception& sight) {
+  think();
+  for (const auto& tile : neighbors) {
+    if (is_enemy(tile.second)) return tile.first;
+  }
+  auto d = sight.toward_food();
+  return d == direction::CENTER? wander(neighbors): d;
+}
+
+direction coward::move(const std::map<direction, std::shared_ptr<critter>>& neighbors) {
+  think();
+  // step directly away from the first enemy in sight, if that tile is free
+  for (std::size_t i = 0; i < directions.size(); ++i) {
+    if (!is_enemy(neighbors.at(directions[i]))) continue;
+    auto away = directions[(i + 4) % directions.size()];
+    const auto& there = neighbors.at(away);
+    if (!there->is_player() && there->name() != "Stone") return away;
+    break;
+  }
+  return wander(neighbors);
+}
+
+std::vector<std::string> reference_critter::names() {
+  return {"walker", "seeker", "fighter", "coward"};
+}
+
+std::shared_ptr<critter> reference_critter::make(const std::string& name, const config& c) {
+  if (name == "walker")  return std::make_shared<walker>(c);
+  if (name == "seeker")  return std::make_shared<seeker>(c);
+  if (name == "fighter") return std::make_shared<fighter>(c);
+  if (name == "coward")  return std::make_shared<coward>(c);
+  return nullptr;
+}
@@ -0,0 +1,172 @@
+#ifndef MESA_CRITTERS_REFERENCE_CRITTERS_H
+#define MESA_CRITTERS_REFERENCE_CRITTERS_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "critter.h"
+
+/**
+ * Base class of the reference critters: simple, open players that give
+ * benchmarks and scaling tests a standard, repeatable workload.
+ *
+ * Every reference critter makes its random choices from a stream of its own.
+ * The first member of a species is seeded by the caller, normally with the
+ * simulator's seed, and each newborn is seeded from the stream of the member
+ * that created it.  Since the simulator creates and moves critters in an order
+ * fixed by its own seed, a run with the same seed plays out the same way.
+ *
+ * Each move can be made to cost a set amount of extra computation,
+ * to stand in for critters that think harder.
+ */
+class reference_critter : public critter {
+  public:
+    /**
+     * How a reference species behaves, shared by all its members.
+     */
+    struct config {
+      uint64_t seed = 1;      /**< seeds the random choices of the first member */
+      unsigned work = 0;      /**< rounds of busy work done for every move */
+    };
+
+    /**
+     * Inform the sim this critter is a competitor.
+     * @return true always.
+     */
+    bool is_player() const override { return true; }
+
+    /**
+     * Pick an attack at random.
+     * @return ROAR, POUNCE or SCRATCH, with equal odds
+     */
+    attack fight(const std::string& opponent) override;
+
+    /**
+     * @return the names of the reference species, as accepted by make()
+     */
+    static std::vector<std::string> names();
+    /**
+     * Make the first member of a reference species.
+     * @param name the name of the species, in lower case: walker, seeker, fighter or coward
+     * @param c how the species behaves
+     * @return the critter, or nullptr if there is no species of that name
+     */
+    static std::shared_ptr<critter> make(const std::string& name, const config& c);
+
+  protected:
+    /**
+     * Create a member of a reference species.
+     * @param name the name of the species
+     * @param c how the species behaves
+     */
+    reference_critter(const std::string& name, const config& c);
+
+    /**
+     * @return the configuration of a newborn created by this critter,
+     *         with a seed drawn from this critter's stream
+     */
+    config spawn();
+    /**
+     * @return the next number in this critter's random stream
+     */
+    uint64_t next();
+    /**
+     * @return a random number from 0 up to, not including, n
+     */
+    unsigned pick(unsigned n) { return unsigned(next() % n); }
+    /**
+     * Do the busy work set for each move.
+     */
+    void think();
+    /**
+     * Pick a neighboring tile at random from those that hold no stone and no
+     * member of this species.
+     * @param neighbors the neighboring tiles
+     * @return the direction of the tile, or CENTER if there is none
+     */
+    direction wander(const std::map<direction, std::shared_ptr<critter>>& neighbors);
+    /**
+     * @return true if a tile holds a player of another species
+     */
+    bool is_enemy(const std::shared_ptr<critter>& it) const;
+
+  private:
+    config config_;           /**< how the species behaves */
+    uint64_t state_;          /**< this critter's random stream */
+};
+
+/**
+ * Wanders at random, eating everything it steps on.
+ */
+class walker : public reference_critter {
+  public:
+    /**
+     * Create a walker.
+     * @param c how the species behaves
+     */
+    explicit walker(const reference_critter::config& c = {}) : reference_critter("Walker", c) { }
+
+    enum color color() const override { return color::CYAN; }
+    std::shared_ptr<critter> create() override { return std::make_shared<walker>(spawn()); }
+    direction move(const std::map<direction, std::shared_ptr<critter>>& neighbors) override;
+    bool eat() override { return true; }
+};
+
+/**
+ * Heads for the nearest food, and eats it.
+ */
+class seeker : public reference_critter {
+  public:
+    /**
+     * Create a seeker.
+     * @param c how the species behaves
+     */
+    explicit seeker(const reference_critter::config& c = {}) : reference_critter("Seeker", c) { }
+
+    enum color color() const override { return color::GREEN; }
+    std::shared_ptr<critter> create() override { return std::make_shared<seeker>(spawn()); }
+    direction survey(const std::map<direction, std::shared_ptr<critter>>& neighbors,
+                     const perception& sight) override;
+    bool eat() override { return true; }
+};
+
+/**
+ * Attacks any other species next to it, and otherwise heads for food.
+ * Only eats when hungry, so it stays awake to fight.
+ */
+class fighter : public reference_critter {
+  public:
+    /**
+     * Create a fighter.
+     * @param c how the species behaves
+     */
+    explicit fighter(const reference_critter::config& c = {}) : reference_critter("Fighter", c) { }
+
+    enum color color() const override { return color::RED; }
+    std::shared_ptr<critter> create() override { return std::make_shared<fighter>(spawn()); }
+    direction survey(const std::map<direction, std::shared_ptr<critter>>& neighbors,
+                     const perception& sight) override;
+    bool eat() override { return food_remaining() < 100; }
+};
+
+/**
+ * Steps away from any other species next to it, and otherwise wanders.
+ */
+class coward : public reference_critter {
+  public:
+    /**
+     * Create a coward.
+     * @param c how the species behaves
+     */
+    explicit coward(const reference_critter::config& c = {}) : reference_critter("Coward", c) { }
+
+    enum color color() const override { return color::YELLOW; }
+    std::shared_ptr<critter> create() override { return std::make_shared<coward>(spawn()); }
+    direction move(const std::map<direction, std::shared_ptr<critter>>& neighbors) override;
+    bool eat() override { return true; }
+};
+
+#endif
@@ -0,0 +1,433 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <iterator>
+#include <deque>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "logger.h"
+#include "remote_species.h"
+
+namespace {
+  constexpr std::size_t chunk = 4096;           // members answered for in one handshake, at most
+  constexpr std::size_t max_notices = 16384;    // notices queued before they are sent on their own
+
+  // the codes of the terrain; species follow
+  enum : uint8_t { EMPTY, FOOD, STONE, FIRST_SPECIES };
+  const char* const terrain_names[] = {"Empty", "Food", "Stone"};
+
+  /**
+   * What the worker is told about a neighbor.
+   */
+  struct cell {
+    uint8_t code;     // empty, food, stone, or FIRST_SPECIES + the species
+    char glyph;
+    uint8_t color;
+    uint8_t state;    // the bits below
+
+    static constexpr uint8_t ASLEEP = 1;
+    static constexpr uint8_t MATING = 2;
+    static constexpr uint8_t BABY = 4;
+  };
+
+  /**
+   * Stands in for a neighbor in the worker.
+   */
+  class mirror : public critter {
+    public:
+      mirror(const std::string& name, bool player) : critter(name), player_(player) {}
+      void set(const cell& c) {
+        glyph_ = c.glyph;
+        color_ = ::color(c.color);
+        restore_state(state {(c.state & cell::ASLEEP) == 0, (c.state & cell::MATING) != 0, false,
+                             (c.state & cell::BABY) != 0? 1: 0, 1, 0});
+      }
+      bool is_player() const override { return player_; }
+      char glyph() const override { return glyph_; }
+      enum color color() const override { return color_; }
+      std::shared_ptr<critter> create() override { return std::make_shared<mirror>(*this); }
+    private:
+      bool player_;
+      char glyph_ = ' ';
+      enum color color_ = ::color::WHITE;
+  };
+} // end anonymous namespace
+
+/**
+ * The memory shared with a worker.
+ * The game writes the notices and views while the worker waits for a turn,
+ * and the worker writes the answers while the game waits for them.
+ * The worker can write any of it at any time, so the game keeps its own counts,
+ * copies them in as it hands over, and checks every answer it reads back.
+ */
+struct remote_species::shared {
+  struct notice_record {
+    uint8_t what;
+    uint32_t id;
+    uint32_t parent;    // for a birth
+  };
+  struct view {
+    uint32_t id;
+    critter::state self;
+    cell neighbors[8];
+  };
+  struct answer {
+    uint8_t move;
+    char glyph;
+    uint8_t color;
+    uint8_t eats;
+    uint8_t fights[max_species];    // the attack against each species, by index
+  };
+
+  uint32_t quit;
+  uint32_t notices;
+  uint32_t views;
+  notice_record notice[max_notices];
+  view views_of[chunk];
+  answer answers[chunk];
+};
+
+std::vector<std::shared_ptr<critter>>
+remote_species::isolate(const std::vector<std::shared_ptr<critter>>& prototypes, const unsigned long& tick) {
+  if (prototypes.size() > max_species) {
+    throw std::invalid_argument("no more than " + std::to_string(max_species) + " species can run in workers");
+  }
+  std::vector<std::string> names;
+  for (const auto& p : prototypes) {
+    names.push_back(p->name());
+  }
+  std::vector<std::shared_ptr<remote_species>> homes;
+  std::vector<std::shared_ptr<critter>> stand_ins;
+  for (std::size_t i = 0; i < prototypes.size(); ++i) {
+    std::shared_ptr<remote_species> home(new remote_species(i, names, tick));
+    home->start(prototypes[i], homes);
+    homes.push_back(home);
+    stand_ins.push_back(std::make_shared<member>(home, 0, prototypes[i]->glyph(), prototypes[i]->color()));
+  }
+  return stand_ins;
+}
+
+remote_species::remote_species(std::size_t index, std::vector<std::string> names, const unsigned long& tick)
+  : index_(index)
+  , names_(std::move(names))
+  , tick_(&tick)
+{
+  auto* base = ::mmap(nullptr, sizeof(shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED) throw std::system_error(errno, std::generic_category(), "shared memory");
+  shared_ = new (base) shared;
+  shared_->quit = 0;
+  shared_->notices = 0;
+  shared_->views = 0;
+  request_ = ::eventfd(0, EFD_CLOEXEC);
+  reply_ = ::eventfd(0, EFD_CLOEXEC);
+  if (request_ < 0 || reply_ < 0) {
+    auto e = errno;
+    if (request_ >= 0) ::close(request_);
+    if (reply_ >= 0) ::close(reply_);
+    ::munmap(shared_, sizeof(shared));
+    throw std::system_error(e, std::generic_category(), "eventfd");
+  }
+}
+
+remote_species::~remote_species() {
+  if (pid_ > 0) {
+    shared_->quit = 1;
+    ::eventfd_write(request_, 1);
+    ::waitpid(pid_, nullptr, 0);
+  }
+  ::close(request_);
+  ::close(reply_);
+  ::munmap(shared_, sizeof(shared));
+}
+
+void remote_species::start(const std::shared_ptr<critter>& prototype,
+                           const std::vector<std::shared_ptr<remote_species>>& others) {
+  auto parent = ::getpid();
+  std::cout.flush();
+  std::cerr.flush();
+  auto pid = ::fork();
+  if (pid < 0) throw std::system_error(errno, std::generic_category(), "fork");
+  if (pid == 0) {
+    // don't outlive the game, even if it is killed
+    ::prctl(PR_SET_PDEATHSIG, SIGKILL);
+    if (::getppid() != parent) ::_exit(0);
+    // a worker reaches nothing of the other species, so it can't answer for them
+    for (const auto& o : others) {
+      ::munmap(o->shared_, sizeof(shared));
+      ::close(o->request_);
+      ::close(o->reply_);
+    }
+    serve(prototype);
+  }
+  pid_ = pid;
+}
+
+void remote_species::serve(std::shared_ptr<critter> prototype) {
+  // _exit throughout: the exit handlers belong to the game
+  std::vector<std::shared_ptr<critter>> members {prototype};
+  // deques, so the mirrors handed out this turn stay put as more are made
+  std::vector<std::deque<std::shared_ptr<critter>>> mirrors(FIRST_SPECIES + names_.size());
+  std::vector<std::size_t> used(mirrors.size());
+  std::vector<neighborhood> views;
+  std::vector<direction> moves;
+
+  // a mirror of a neighbor, reused from turn to turn
+  auto reflect = [&](const cell& c) -> const std::shared_ptr<critter>* {
+    std::size_t code = c.code < mirrors.size()? c.code: std::size_t(EMPTY);
+    auto& pool = mirrors[code];
+    if (used[code] == pool.size()) {
+      pool.push_back(std::make_shared<mirror>(code < FIRST_SPECIES? terrain_names[code]: names_[code - FIRST_SPECIES],
+                                              code >= FIRST_SPECIES));
+    }
+    auto& m = pool[used[code]++];
+    static_cast<mirror&>(*m).set(c);
+    return &m;
+  };
+
+  try {
+    for (;;) {
+      eventfd_t ignored;
+      while (::eventfd_read(request_, &ignored) != 0) {
+        if (errno != EINTR) ::_exit(1);
+      }
+      if (shared_->quit) ::_exit(0);
+
+      // notices come first, so a turn may be for a member just born
+
+      auto notices = std::min<uint32_t>(shared_->notices, max_notices);
+      for (uint32_t i = 0; i < notices; ++i) {
+        const auto& n = shared_->notice[i];
+        if (n.what == BIRTH) {
+          if (members.size() <= n.id) members.resize(n.id + 1);
+          auto& parent = n.parent < members.size() && members[n.parent]? members[n.parent]: members[0];
+          members[n.id] = parent->create();
+          continue;
+        }
+        if (n.id >= members.size() || !members[n.id]) continue;
+        switch (n.what) {
+          case DEATH: members[n.id].reset(); break;
+          case WON:   members[n.id]->won();  break;
+          case LOST:  members[n.id]->lost(); break;
+          case DRAW:  members[n.id]->draw(); break;
+          case SLEEP: members[n.id]->sleep(); break;
+        }
+      }
+
+      auto count = std::min<uint32_t>(shared_->views, chunk);
+      std::fill(used.begin(), used.end(), 0);
+      views.assign(count, neighborhood {});
+      moves.assign(count, direction::CENTER);
+      std::size_t moving = 0;
+      std::vector<uint32_t> order;     // the view each member asked is in
+      order.reserve(count);
+      for (uint32_t i = 0; i < count; ++i) {
+        const auto& v = shared_->views_of[i];
+        if (v.id >= members.size() || !members[v.id]) continue;
+        auto& self = *members[v.id];
+        self.restore_state(v.self);
+        auto& n = views[moving++];
+        n.self = &self;
+        for (std::size_t d = 0; d < 8; ++d) {
+          n.neighbors[d] = reflect(v.neighbors[d]);
+        }
+        order.push_back(i);
+      }
+      if (moving > 0) prototype->move_batch(views.data(), moves.data(), moving);
+
+      for (uint32_t i = 0; i < count; ++i) {
+        auto& a = shared_->answers[i];
+        a = shared::answer {uint8_t(direction::CENTER), ' ', uint8_t(::color::WHITE), 0, {}};
+        std::fill(std::begin(a.fights), std::end(a.fights), uint8_t(critter::attack::FORFEIT));
+      }
+      // whether each eats, and how it fights each other species, go back with the moves,
+      // so the game never has to ask in the middle of a turn
+      for (std::size_t j = 0; j < moving; ++j) {
+        auto& c = *views[j].self;
+        auto& a = shared_->answers[order[j]];
+        a.move = uint8_t(moves[j]);
+        a.glyph = c.glyph();
+        a.color = uint8_t(c.color());
+        a.eats = c.eat()? 1: 0;
+        for (std::size_t k = 0; k < names_.size(); ++k) {
+          if (k != index_) a.fights[k] = uint8_t(c.fight(names_[k]));
+        }
+      }
+
+      if (::eventfd_write(reply_, 1) != 0) ::_exit(1);
+    }
+  } catch (...) {
+    ::_exit(2);
+  }
+}
+
+void remote_species::notify(notice what, uint32_t id, uint32_t parent) {
+  if (forfeited_) return;
+  if (notices_ == max_notices) {
+    exchange(0);
+    if (forfeited_) return;
+  }
+  shared_->notice[notices_++] = shared::notice_record {what, id, parent};
+}
+
+bool remote_species::exchange(uint32_t views) {
+  if (forfeited_) return false;
+  using namespace std::chrono;
+  shared_->notices = notices_;
+  shared_->views = views;
+  if (::eventfd_write(request_, 1) != 0) {
+    forfeit(logger::event::WORKER_LOST, uint32_t(errno));
+    return false;
+  }
+  auto deadline = steady_clock::now() + seconds(answer_limit);
+  for (;;) {
+    pollfd p {reply_, POLLIN, 0};
+    auto ready = ::poll(&p, 1, 100);
+    if (ready > 0) {
+      eventfd_t ignored;
+      ::eventfd_read(reply_, &ignored);
+      notices_ = 0;
+      return true;
+    }
+    if (ready < 0 && errno != EINTR) {
+      forfeit(logger::event::WORKER_LOST, uint32_t(errno));
+      return false;
+    }
+    int status = 0;
+    if (::waitpid(pid_, &status, WNOHANG) == pid_) {
+      pid_ = -1;
+      if (WIFSIGNALED(status)) {
+        forfeit(logger::event::WORKER_KILLED, uint32_t(WTERMSIG(status)));
+      } else {
+        forfeit(logger::event::WORKER_EXITED, uint32_t(WEXITSTATUS(status)));
+      }
+      return false;
+    }
+    if (steady_clock::now() > deadline) {
+      ::kill(pid_, SIGKILL);
+      ::waitpid(pid_, nullptr, 0);
+      pid_ = -1;
+      forfeit(logger::event::WORKER_HUNG, uint32_t(answer_limit));
+      return false;
+    }
+  }
+}
+
+void remote_species::forfeit(logger::event why, uint32_t arg) {
+  forfeited_ = true;
+  // not straight to std::cerr, which may be under the screen
+  if (logger::on(why)) {
+    logger::write(why, *tick_, names_[index_], point(), std::string(), point(), arg);
+  }
+}
+
+uint8_t remote_species::code_of(const critter& it) {
+  if (auto* m = dynamic_cast<const member*>(&it)) {
+    return uint8_t(FIRST_SPECIES + m->home_->index_);
+  }
+  for (const auto& t : terrain_) {
+    if (t.first == &it) return t.second;
+  }
+  // terrain is shared by every tile of its kind, so this is done once for each
+  auto name = it.name();
+  uint8_t code = EMPTY;
+  for (uint8_t c = EMPTY; c < FIRST_SPECIES; ++c) {
+    if (name == terrain_names[c]) code = c;
+  }
+  if (!it.is_player()) terrain_.emplace_back(&it, code);
+  return code;
+}
+
+uint32_t remote_species::new_id() {
+  if (free_ids_.empty()) return next_id_++;
+  auto id = free_ids_.back();
+  free_ids_.pop_back();
+  return id;
+}
+
+remote_species::member::member(std::shared_ptr<remote_species> home, uint32_t id, char glyph, enum color c)
+  : critter(home->names_[home->index_])
+  , home_(std::move(home))
+  , id_(id)
+  , glyph_(glyph)
+  , color_(c)
+{
+  std::fill(std::begin(fights_), std::end(fights_), uint8_t(attack::FORFEIT));
+}
+
+remote_species::member::~member() {
+  if (id_ == 0) return;
+  home_->notify(DEATH, id_);
+  home_->free_ids_.push_back(id_);
+}
+
+std::shared_ptr<critter> remote_species::member::create() {
+  auto id = home_->new_id();
+  home_->notify(BIRTH, id, id_);
+  auto baby = std::make_shared<member>(home_, id, glyph_, color_);
+  // until its first turn, a baby eats and fights as its parent last said
+  baby->eats_ = eats_;
+  std::copy(std::begin(fights_), std::end(fights_), std::begin(baby->fights_));
+  return baby;
+}
+
+void remote_species::member::move_batch(const neighborhood* views, direction* moves, std::size_t count) {
+  auto& home = *home_;
+  for (std::size_t first = 0; first < count; first += chunk) {
+    auto n = std::min(chunk, count - first);
+    for (std::size_t i = 0; i < n; ++i) {
+      const auto& v = views[first + i];
+      auto& out = home.shared_->views_of[i];
+      out.id = static_cast<const member*>(v.self)->id_;
+      out.self = v.self->save_state();
+      for (std::size_t d = 0; d < 8; ++d) {
+        const auto& c = *v[d];
+        out.neighbors[d] = cell {home.code_of(c), c.glyph(), uint8_t(c.color()),
+                                 uint8_t((c.is_asleep()? cell::ASLEEP: 0) | (c.is_mating()? cell::MATING: 0) |
+                                         (c.is_baby()? cell::BABY: 0))};
+      }
+    }
+    if (!home.exchange(uint32_t(n))) {
+      std::fill(moves + first, moves + count, direction::CENTER);
+      return;
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+      const auto& a = home.shared_->answers[i];
+      auto& m = *static_cast<member*>(views[first + i].self);
+      // whatever the worker wrote, only a real move and color are taken
+      moves[first + i] = a.move <= uint8_t(direction::NORTH_WEST)? direction(a.move): direction::CENTER;
+      m.glyph_ = a.glyph;
+      m.color_ = a.color <= uint8_t(::color::WHITE)? ::color(a.color): ::color::WHITE;
+      m.eats_ = a.eats != 0;
+      for (std::size_t k = 0; k < home.names_.size(); ++k) {
+        m.fights_[k] = a.fights[k] <= uint8_t(attack::FORFEIT)? a.fights[k]: uint8_t(attack::FORFEIT);
+      }
+    }
+  }
+}
+
+critter::attack remote_species::member::fight(const std::string& opponent) {
+  if (home_->forfeited_) return attack::FORFEIT;
+  const auto& names = home_->names_;
+  auto k = std::size_t(std::find(names.begin(), names.end(), opponent) - names.begin());
+  return k < names.size()? attack(fights_[k]): attack::FORFEIT;
+}
+
+bool remote_species::member::eat() {
+  return eats_ && !home_->forfeited_;
+}
+
+void remote_species::member::won()   const { home_->notify(WON, id_); }
+void remote_species::member::lost()  const { home_->notify(LOST, id_); }
+void remote_species::member::draw()  const { home_->notify(DRAW, id_); }
+void remote_species::member::sleep() const { home_->notify(SLEEP, id_); }
@@ -0,0 +1,187 @@
+#ifndef MESA_CRITTERS_REMOTE_SPECIES_H
+#define MESA_CRITTERS_REMOTE_SPECIES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "critter.h"
+#include "logger.h"
+
+/**
+ * Runs the code of a species in a worker process of its own,
+ * so a species that crashes or hangs can't take the game down with it.
+ *
+ * The game keeps playing with stand-ins, one for every member of the species.
+ * A stand-in keeps the state the simulator manages, such as food and sleep,
+ * and answers questions with what the worker last said.
+ * The critters themselves, with whatever state they keep of their own,
+ * live only in the worker.
+ *
+ * Each turn of the species, the stand-in prototype writes the neighbors of
+ * every member that can move into memory shared with the worker, and the worker
+ * answers for all of them at once: the move, how the critter looks,
+ * whether it eats, and how it fights each of the other species.
+ * That is one eventfd handshake per species per turn, however many members there are.
+ * The stand-ins keep the answers to eat() and fight() until the next turn,
+ * so a critter is asked about every meal and fight it might have, every turn,
+ * rather than about the ones it does have: a critter that counts or adapts
+ * in eat() or fight() plays differently than it would in the game.
+ * Births, deaths and the won, lost, draw and sleep notifications are queued,
+ * and delivered before the next turn.
+ *
+ * Critters see only their eight neighbors: perception needs the whole world,
+ * which stays with the game.
+ *
+ * A worker can reach only its own species: the memory and eventfds shared with
+ * the workers started before it are closed as it starts.  Workers should be
+ * started before the program starts any thread.
+ *
+ * If the worker dies, or takes longer than answer_limit to answer,
+ * the species forfeits, and the reason is logged as an error:
+ * from then on its members stay put, don't eat, and forfeit every fight.
+ */
+class remote_species {
+  public:
+    static constexpr std::size_t max_species = 32;      /**< the most species that can be isolated together */
+    static constexpr int answer_limit = 10;             /**< seconds a worker has to answer */
+
+    /**
+     * Move every species into a worker process of its own.
+     * The prototypes are copied into the workers when they fork;
+     * the game should keep only the stand-ins returned.
+     * @param prototypes a critter of each species, each of a different name
+     * @param tick the tick of the game, for the log
+     * @return a stand-in prototype for each, in the same order
+     * @throws std::invalid_argument if there are too many species,
+     *         std::system_error if a worker can't be started
+     */
+    static std::vector<std::shared_ptr<critter>>
+    isolate(const std::vector<std::shared_ptr<critter>>& prototypes, const unsigned long& tick);
+
+    /**
+     * Stop the worker.
+     */
+    ~remote_species();
+    remote_species(const remote_species&) = delete;
+    remote_species& operator=(const remote_species&) = delete;
+
+    /**
+     * Stands in for a member of a remote species.
+     */
+    class member : public critter {
+      public:
+        /**
+         * Create a stand-in.
+         * @param home the species
+         * @param id the number of the member in the worker
+         * @param glyph how it looks, until the worker says otherwise
+         * @param c its color, likewise
+         */
+        member(std::shared_ptr<remote_species> home, uint32_t id, char glyph, enum color c);
+        /**
+         * Tell the worker the member is gone.
+         */
+        ~member() override;
+
+        bool is_player() const override { return true; }
+        char glyph() const override { return glyph_; }
+        enum color color() const override { return color_; }
+        std::shared_ptr<critter> create() override;
+        /**
+         * Have the worker move every member at once.
+         */
+        void move_batch(const neighborhood* views, direction* moves, std::size_t count) override;
+        /**
+         * @return how the worker last said the member fights the opponent
+         */
+        attack fight(const std::string& opponent) override;
+        /**
+         * @return whether the worker last said the member eats
+         */
+        bool eat() override;
+        void won()   const override;
+        void lost()  const override;
+        void draw()  const override;
+        void sleep() const override;
+
+      private:
+        friend class remote_species;
+        std::shared_ptr<remote_species> home_;    /**< the species */
+        uint32_t id_;                             /**< the number of the member in the worker */
+        char glyph_;                              /**< the glyph the worker last gave */
+        enum color color_;                        /**< the color the worker last gave */
+        bool eats_ = false;                       /**< whether it eats, as the worker last said */
+        uint8_t fights_[max_species];             /**< its attack against each species, as the worker last said */
+    };
+
+  private:
+    struct shared;
+
+    /**
+     * Things the worker is told before a turn.
+     */
+    enum notice : uint8_t { BIRTH, DEATH, WON, LOST, DRAW, SLEEP };
+
+    /**
+     * Set up the memory and eventfds shared with a worker.
+     */
+    remote_species(std::size_t index, std::vector<std::string> names, const unsigned long& tick);
+
+    /**
+     * Fork the worker.
+     * @param prototype the critter of the species, which the worker copies
+     * @param others the species started before, which the worker lets go of
+     */
+    void start(const std::shared_ptr<critter>& prototype,
+               const std::vector<std::shared_ptr<remote_species>>& others);
+    /**
+     * The worker: answer each turn until told to quit.
+     */
+    [[noreturn]] void serve(std::shared_ptr<critter> prototype);
+
+    /**
+     * Queue a notice for the worker, sending the queue if it is full.
+     */
+    void notify(notice what, uint32_t id, uint32_t parent = 0);
+    /**
+     * Hand the shared memory to the worker, with the notices queued, and wait for its answer.
+     * @param views the members to move; 0 to deliver only the notices
+     * @return false if the species has forfeited
+     */
+    bool exchange(uint32_t views);
+    /**
+     * Give up on the worker.
+     * @param why what happened to it: one of the worker events of the logger
+     * @param arg the number logged with it
+     */
+    void forfeit(logger::event why, uint32_t arg);
+
+    /**
+     * @return the code of what a neighbor is, for the worker:
+     *         empty, food, stone, or a species
+     */
+    uint8_t code_of(const critter& it);
+    /**
+     * @return the number of a new member
+     */
+    uint32_t new_id();
+
+    std::size_t index_;                     /**< the position of this species among those isolated */
+    std::vector<std::string> names_;        /**< every species isolated, by index */
+    const unsigned long* tick_;             /**< the tick of the game */
+    shared* shared_ = nullptr;              /**< the memory shared with the worker */
+    int request_ = -1;                      /**< eventfd the game signals a turn on */
+    int reply_ = -1;                        /**< eventfd the worker answers on */
+    int pid_ = -1;                          /**< the worker, or -1 once it is gone */
+    bool forfeited_ = false;                /**< true once the worker is given up on */
+    uint32_t notices_ = 0;                  /**< notices queued; kept here, out of the worker's reach */
+    uint32_t next_id_ = 1;                  /**< the lowest member number never used; 0 is the prototype */
+    std::vector<uint32_t> free_ids_;        /**< member numbers of the dead, to use again */
+    std::vector<std::pair<const critter*, uint8_t>> terrain_;  /**< codes of the terrain seen so far */
+};
+
+#endif
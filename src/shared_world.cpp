@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "occupancy.h"
+#include "shared_world.h"
+
+shared_world::shared_world(const std::string& name, int width, int height)
+  : name_(name)
+  , size_(sizeof(header) + std::size_t(width) * std::size_t(height) * sizeof(cell))
+{
+  ::shm_unlink(name.c_str());
+  int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) throw std::system_error(errno, std::generic_category(), name);
+  if (::ftruncate(fd, off_t(size_)) != 0) {
+    auto e = errno;
+    ::close(fd);
+    ::shm_unlink(name.c_str());
+    throw std::system_error(e, std::generic_category(), name);
+  }
+  auto* base = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  auto e = errno;
+  ::close(fd);
+  if (base == MAP_FAILED) {
+    ::shm_unlink(name.c_str());
+    throw std::system_error(e, std::generic_category(), name);
+  }
+
+  // a new segment is zero filled; the sequence stays odd until the first tick is published
+  header_ = new (base) header;
+  cells_ = reinterpret_cast<cell*>(static_cast<char*>(base) + sizeof(header));
+  header_->sequence.store(1, std::memory_order_relaxed);
+  std::memcpy(header_->magic, "CRSW", sizeof(header_->magic));
+  header_->version = version;
+  header_->width = uint32_t(width);
+  header_->height = uint32_t(height);
+  for (std::size_t i = 0; i < std::size_t(width) * std::size_t(height); ++i) {
+    cells_[i] = cell {' ', uint8_t(color::WHITE), 0, 0};
+  }
+}
+
+shared_world::~shared_world() {
+  ::munmap(header_, size_);
+  ::shm_unlink(name_.c_str());
+}
+
+void shared_world::publish(unsigned long tick, const std::vector<std::shared_ptr<critter>>& kinds,
+                           const std::map<std::string, std::shared_ptr<species>>& players) {
+  auto sequence = header_->sequence.load(std::memory_order_relaxed) | 1;
+  header_->sequence.store(sequence, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  for (const auto& u : dirty_) {
+    cells_[u.slot] = u.value;
+  }
+  dirty_.clear();
+  header_->tick = tick;
+  header_->first_species = occupancy::FIRST_SPECIES;
+  header_->species = uint32_t(std::min(kinds.size(), max_species));
+  for (std::size_t i = 0; i < header_->species; ++i) {
+    auto& c = header_->counters[i];
+    std::memset(&c, 0, sizeof(c));
+    if (!kinds[i]) continue;
+    auto name = kinds[i]->name();
+    std::strncpy(c.name, name.c_str(), name_size - 1);
+    auto p = players.find(name);
+    if (p == players.end()) continue;
+    const auto& s = *p->second;
+    c.alive = s.alive();
+    c.dead = s.dead();
+    c.kills = s.kills();
+    c.feedings = s.feedings();
+    c.starved = s.starved();
+    c.score = s.score();
+  }
+
+  header_->sequence.store(sequence + 1, std::memory_order_release);
+}
+
+shared_world::reader::reader(const std::string& name) {
+  int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0) throw std::system_error(errno, std::generic_category(), name);
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    auto e = errno;
+    ::close(fd);
+    throw std::system_error(e, std::generic_category(), name);
+  }
+  size_ = std::size_t(st.st_size);
+  auto* base = size_ < sizeof(header)? MAP_FAILED: ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+  auto e = errno;
+  ::close(fd);
+  if (size_ < sizeof(header)) throw std::runtime_error(name + " is not a published world");
+  if (base == MAP_FAILED) throw std::system_error(e, std::generic_category(), name);
+
+  header_ = static_cast<const header*>(base);
+  cells_ = reinterpret_cast<const cell*>(static_cast<const char*>(base) + sizeof(header));
+  if (std::memcmp(header_->magic, "CRSW", sizeof(header_->magic)) != 0 || header_->version != version ||
+      size_ < sizeof(header) + std::size_t(header_->width) * header_->height * sizeof(cell)) {
+    ::munmap(const_cast<header*>(header_), size_);
+    throw std::runtime_error(name + " is not a published world of version " + std::to_string(version));
+  }
+}
+
+shared_world::reader::~reader() {
+  ::munmap(const_cast<header*>(header_), size_);
+}
@@ -0,0 +1,171 @@
+#ifndef MESA_CRITTERS_SHARED_WORLD_H
+#define MESA_CRITTERS_SHARED_WORLD_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "critter.h"
+#include "species.h"
+
+/**
+ * Publishes the world to other processes through a POSIX shared memory segment.
+ *
+ * The segment holds a header, the counters of every species, and a grid of
+ * cells, one per tile, row by row.  The simulation writes it at the end of each
+ * tick and never waits for readers; readers map it read-only and never write
+ * to it, so any number of them can watch without slowing the simulation.
+ *
+ * Consistency is kept with a sequence lock.  The sequence number is odd while
+ * the simulation writes, and goes up by two for every tick published.
+ * A reader loads the sequence number, waiting while it is odd, reads what it
+ * needs in place, then loads the sequence number again: if it is unchanged,
+ * what was read belongs to a single tick, otherwise it reads again.
+ * shared_world::reader does exactly that.
+ *
+ * Only the tiles drawn during a tick are written, so publishing costs in
+ * proportion to how much changes, not to the size of the world.
+ */
+class shared_world {
+  public:
+    static constexpr uint32_t version = 1;          /**< the layout version */
+    static constexpr std::size_t max_species = 32;  /**< the most species published */
+    static constexpr std::size_t name_size = 32;    /**< bytes for a species name, with its terminating 0 */
+
+    /**
+     * How a tile looks, and what occupies it.
+     */
+    struct cell {
+      char glyph;             /**< the character shown */
+      uint8_t color;          /**< the color, as its position in the color enum */
+      uint8_t state;          /**< ASLEEP and MATING bits */
+      uint8_t kind;           /**< the occupancy kind: empty, food, stone or a species */
+
+      static constexpr uint8_t ASLEEP = 1;    /**< the critter is asleep */
+      static constexpr uint8_t MATING = 2;    /**< the critter is mating */
+    };
+
+    /**
+     * The counters of one species.
+     */
+    struct species_counters {
+      char name[name_size];   /**< the name, 0 terminated */
+      uint32_t alive;         /**< @see species::alive */
+      uint32_t dead;          /**< @see species::dead */
+      uint32_t kills;         /**< @see species::kills */
+      uint32_t feedings;      /**< @see species::feedings */
+      uint32_t starved;       /**< @see species::starved */
+      uint32_t score;         /**< @see species::score */
+    };
+
+    /**
+     * The start of the segment.  The cells follow it.
+     */
+    struct header {
+      char magic[4];                  /**< "CRSW" */
+      uint32_t version;               /**< the layout version */
+      uint32_t width;                 /**< width of the world */
+      uint32_t height;                /**< height of the world */
+      uint32_t species;               /**< species published */
+      uint32_t first_species;         /**< the kind of species[0]; each species after is one kind up */
+      std::atomic<uint64_t> sequence; /**< odd while being written */
+      uint64_t tick;                  /**< the tick published */
+      species_counters counters[max_species];   /**< counters of every species, by kind */
+    };
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "the sequence must be lock free to be shared");
+
+    /**
+     * Create a segment, replacing any of the same name.
+     * @param name the name of the segment, such as /critters
+     * @param width the world width
+     * @param height the world height
+     * @throws std::system_error if the segment can't be made
+     */
+    shared_world(const std::string& name, int width, int height);
+    /**
+     * Unmap the segment and remove its name.
+     * Readers that have it mapped can still read the last tick published.
+     */
+    ~shared_world();
+    shared_world(const shared_world&) = delete;
+    shared_world& operator=(const shared_world&) = delete;
+
+    /**
+     * Note that a tile was drawn, to be written when the tick is published.
+     * @param slot the position of the tile in the grid, y * width + x
+     * @param it what is on the tile
+     * @param kind its occupancy kind
+     */
+    void drawn(std::size_t slot, const critter& it, uint8_t kind) {
+      auto state = uint8_t((it.is_asleep()? cell::ASLEEP: 0) | (it.is_mating()? cell::MATING: 0));
+      dirty_.push_back({uint32_t(slot), cell {it.glyph(), uint8_t(it.color()), state, kind}});
+    }
+    /**
+     * Write every tile drawn since the last call, the counters and the tick.
+     * @param tick the tick just played
+     * @param kinds the species of each kind, from occupancy::FIRST_SPECIES up; may hold nulls
+     * @param players the counters of each species, by name
+     */
+    void publish(unsigned long tick, const std::vector<std::shared_ptr<critter>>& kinds,
+                 const std::map<std::string, std::shared_ptr<species>>& players);
+
+    /**
+     * Maps a published world read-only.
+     */
+    class reader {
+      public:
+        /**
+         * Map a segment.
+         * @param name the name of the segment
+         * @throws std::system_error if it can't be mapped,
+         *         std::runtime_error if it is not a published world of a known version
+         */
+        explicit reader(const std::string& name);
+        ~reader();
+        reader(const reader&) = delete;
+        reader& operator=(const reader&) = delete;
+
+        /**
+         * Read a single tick.
+         * Calls f until what it reads all belongs to the same tick.
+         * f reads the segment in place and must not keep pointers into it.
+         * @param f a callable taking the header and the cells
+         */
+        template <class F>
+        void read(F&& f) const {
+          for (;;) {
+            auto before = header_->sequence.load(std::memory_order_acquire);
+            if (before & 1) continue;
+            f(*header_, cells_);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (header_->sequence.load(std::memory_order_relaxed) == before) return;
+          }
+        }
+
+      private:
+        const header* header_ = nullptr;    /**< the start of the segment */
+        const cell* cells_ = nullptr;       /**< the grid */
+        std::size_t size_ = 0;              /**< bytes mapped */
+    };
+
+  private:
+    /**
+     * A cell waiting to be written.
+     */
+    struct update {
+      uint32_t slot;          /**< the position in the grid */
+      cell value;             /**< the new contents */
+    };
+
+    std::string name_;              /**< the name of the segment */
+    header* header_ = nullptr;      /**< the start of the segment */
+    cell* cells_ = nullptr;         /**< the grid */
+    std::size_t size_ = 0;          /**< bytes mapped */
+    std::vector<update> dirty_;     /**< cells drawn since the last tick published */
+};
+
+#endif
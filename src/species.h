@@ -33,6 +33,19 @@ class species {
     species(std::string species_name, unsigned int initial_pop) : 
       name_(species_name), num_alive_(initial_pop), 
       num_dead_(0), num_kills_(0), num_feedings_(0), num_starved_(0) {}
+    /**
+     * Recreate a species from its statistics, for example from a saved game.
+     * @param species_name name of this species
+     * @param alive the number of living members
+     * @param dead the number of dead members
+     * @param kills the number of critters killed
+     * @param feedings the number of food eaten
+     * @param starved the number of members that starved
+     */
+    species(std::string species_name, unsigned int alive, unsigned int dead,
+            unsigned int kills, unsigned int feedings, unsigned int starved) :
+      name_(species_name), num_alive_(alive),
+      num_dead_(dead), num_kills_(kills), num_feedings_(feedings), num_starved_(starved) {}
 
     /**
      * Get the name of this Species.
@@ -0,0 +1,309 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <unistd.h>
+
+#include "game.h"
+#include "sweep.h"
+#include "view_headless.h"
+
+const std::array<const char*, sweep::parameters> sweep::names = {{
+  "x", "y", "f", "s", "n", "stone_sleep", "mating_rest"
+}};
+
+namespace {
+  // positions of the parameters in sweep::names
+  enum { X, Y, FOOD, STONES, CRITTERS, STONE_SLEEP, MATING_REST };
+
+  long to_long(const std::string& text, const std::string& spec) {
+    std::size_t used = 0;
+    long value = 0;
+    try {
+      value = std::stol(text, &used);
+    } catch (const std::exception&) {
+      used = 0;
+    }
+    if (used == 0 || used != text.size()) {
+      throw std::invalid_argument("not a number in " + spec + ": '" + text + "'");
+    }
+    return value;
+  }
+
+  std::vector<std::string> split(const std::string& text, char sep) {
+    std::vector<std::string> parts;
+    std::size_t start = 0;
+    while (true) {
+      auto end = text.find(sep, start);
+      parts.push_back(text.substr(start, end - start));
+      if (end == std::string::npos) break;
+      start = end + 1;
+    }
+    return parts;
+  }
+} // end anonymous namespace
+
+sweep::sweep(const settings& defaults, roster players, const layout& shape,
+             unsigned long ticks, uint64_t first_seed)
+  : players_(std::move(players))
+  , shape_(shape)
+  , ticks_(ticks)
+  , first_seed_(first_seed)
+{
+  for (std::size_t i = 0; i < parameters; ++i) {
+    grid_[i] = {defaults[i]};
+  }
+  // the game keeps its scores sorted by name, and so do the columns
+  std::set<std::string> species;
+  for (const auto& c: players_(first_seed_)) {
+    species.insert(c->name());
+  }
+  species_.assign(species.begin(), species.end());
+}
+
+void sweep::add(const std::string& spec) {
+  auto eq = spec.find('=');
+  if (eq == std::string::npos) {
+    throw std::invalid_argument("expected name=values: '" + spec + "'");
+  }
+  auto name = spec.substr(0, eq);
+  auto text = spec.substr(eq + 1);
+
+  if (name == "seeds") {
+    auto n = to_long(text, spec);
+    if (n < 1) throw std::invalid_argument("seeds must be at least 1: '" + spec + "'");
+    seeds_ = std::size_t(n);
+    return;
+  }
+
+  auto found = std::find_if(names.begin(), names.end(),
+      [&name](const char* n) { return name == n; });
+  if (found == names.end()) {
+    throw std::invalid_argument("unknown parameter '" + name + "'");
+  }
+  const auto i = std::size_t(found - names.begin());
+
+  std::vector<long> values;
+  if (auto range = split(text, ':'); range.size() == 3) {
+    auto first = to_long(range[0], spec);
+    auto last  = to_long(range[1], spec);
+    auto step  = to_long(range[2], spec);
+    if (step < 1 || last < first) {
+      throw std::invalid_argument("expected first:last:step with first <= last and step > 0: '" + spec + "'");
+    }
+    for (auto v = first; v <= last; v += step) values.push_back(v);
+  } else if (range.size() == 1) {
+    for (const auto& v: split(text, ',')) values.push_back(to_long(v, spec));
+  } else {
+    throw std::invalid_argument("expected first:last:step: '" + spec + "'");
+  }
+
+  const long low = (i == X || i == Y)? 3: 0;
+  const long high = (i == X || i == Y)? 32767: 1000000000;
+  for (auto v: values) {
+    if (v < low || v > high) {
+      throw std::invalid_argument(name + " must be from " + std::to_string(low) +
+                                  " to " + std::to_string(high) + ": '" + spec + "'");
+    }
+  }
+  grid_[i] = std::move(values);
+}
+
+std::size_t sweep::size() const {
+  std::size_t n = seeds_;
+  for (const auto& values: grid_) n *= values.size();
+  return n;
+}
+
+std::vector<sweep::job> sweep::jobs() const {
+  // count through the grid like an odometer, with x as the slowest wheel,
+  // so runs on the same size of world come together
+  std::vector<job> all;
+  all.reserve(size());
+  std::array<std::size_t, parameters> at {};
+  while (true) {
+    job j;
+    for (std::size_t i = 0; i < parameters; ++i) {
+      j.values[i] = grid_[i][at[i]];
+    }
+    for (std::size_t s = 0; s < seeds_; ++s) {
+      j.seed = first_seed_ + s;
+      all.push_back(j);
+    }
+    auto i = parameters;
+    while (i > 0 && ++at[i - 1] == grid_[i - 1].size()) {
+      at[--i] = 0;
+    }
+    if (i == 0) break;
+  }
+  return all;
+}
+
+std::string sweep::header() const {
+  std::string line;
+  for (auto n: names) {
+    line += n;
+    line += ',';
+  }
+  line += "seed,ticks";
+  for (const auto& s: species_) {
+    for (auto column: {".alive", ".dead", ".kills", ".feedings", ".starved", ".score"}) {
+      line += ',' + s + column;
+    }
+  }
+  return line;
+}
+
+std::string sweep::key(const job& j) {
+  std::string k;
+  for (auto v: j.values) {
+    k += std::to_string(v);
+    k += ',';
+  }
+  k += std::to_string(j.seed);
+  return k;
+}
+
+std::vector<std::string> sweep::recorded(const std::string& path) const {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return {};
+  std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+  if (text.empty()) return {};
+
+  // a row cut short by an interrupted sweep is dropped, and its run played again
+  auto end = text.rfind('\n');
+  auto complete = end == std::string::npos? 0: end + 1;
+  if (complete < text.size()) {
+    if (::truncate(path.c_str(), off_t(complete)) != 0) {
+      throw std::system_error(errno, std::generic_category(), path);
+    }
+    text.resize(complete);
+  }
+
+  auto lines = split(text, '\n');
+  if (lines.empty() || lines[0] != header()) {
+    throw std::runtime_error(path + " holds the results of a different sweep");
+  }
+  std::vector<std::string> keys;
+  for (std::size_t i = 1; i < lines.size(); ++i) {
+    // the key is every column up to and including the seed
+    std::size_t at = 0;
+    for (std::size_t c = 0; c <= parameters && at != std::string::npos; ++c) {
+      at = lines[i].find(',', at + (c == 0? 0: 1));
+    }
+    if (at != std::string::npos) keys.push_back(lines[i].substr(0, at));
+  }
+  return keys;
+}
+
+std::size_t sweep::run(const std::string& path, unsigned threads) {
+  const auto all = jobs();
+  for (const auto& j: all) {
+    auto items = j.values[FOOD] + j.values[STONES] + j.values[CRITTERS] * long(species_.size());
+    if (items > j.values[X] * j.values[Y]) {
+      throw std::invalid_argument(std::to_string(items) + " items don't fit in a " +
+                                  std::to_string(j.values[X]) + 'x' + std::to_string(j.values[Y]) + " world");
+    }
+  }
+
+  auto keys = recorded(path);
+  const bool fresh = keys.empty() && std::ifstream(path).peek() == std::ifstream::traits_type::eof();
+  std::unordered_set<std::string> done(keys.begin(), keys.end());
+  std::vector<job> todo;
+  for (const auto& j: all) {
+    if (done.count(key(j)) == 0) todo.push_back(j);
+  }
+
+  std::ofstream out(path, std::ios::binary | std::ios::app);
+  if (!out) throw std::system_error(errno, std::generic_category(), path);
+  if (fresh) out << header() << '\n' << std::flush;
+
+  threads = std::max(1u, std::min(threads, unsigned(todo.size())));
+  std::cerr << "Sweep: " << all.size() << " runs, " << all.size() - todo.size()
+            << " already in " << path << ", playing " << todo.size()
+            << " on " << threads << " threads.\n";
+  const auto started = std::chrono::steady_clock::now();
+
+  std::atomic<std::size_t> next {0};
+  std::mutex lock;      // guards out, finished and failure
+  std::size_t finished = 0;
+  std::exception_ptr failure;
+
+  auto worker = [&]() {
+    std::unique_ptr<game> g;
+    long width = 0;
+    long height = 0;
+    for (auto i = next++; i < todo.size(); i = next++) {
+      try {
+        const auto& j = todo[i];
+        if (!g || j.values[X] != width || j.values[Y] != height) {
+          width = j.values[X];
+          height = j.values[Y];
+          g = std::make_unique<game>();
+          g->set_view(std::make_unique<view_headless>(int(height), int(width)));
+        } else {
+          g->reset();
+        }
+        g->set_seed(j.seed);
+        g->set_rules(rules {int(j.values[STONE_SLEEP]), int(j.values[MATING_REST])});
+        std::vector<std::pair<std::shared_ptr<critter>, int>> players;
+        for (auto& c: players_(j.seed)) {
+          players.emplace_back(std::move(c), int(j.values[CRITTERS]));
+        }
+        g->generate(int(j.values[STONES]), int(j.values[FOOD]), players, shape_);
+        g->play(ticks_);
+
+        auto row = key(j) + ',' + std::to_string(g->ticks());
+        const auto& scores = g->scores();
+        for (const auto& name: species_) {
+          auto s = scores.find(name);
+          if (s == scores.end()) {
+            row += ",0,0,0,0,0,0";
+            continue;
+          }
+          for (auto v: {s->second->alive(), s->second->dead(), s->second->kills(),
+                        s->second->feedings(), s->second->starved(), s->second->score()}) {
+            row += ',' + std::to_string(v);
+          }
+        }
+        row += '\n';
+
+        std::lock_guard<std::mutex> guard(lock);
+        out << row << std::flush;
+        if (!out) throw std::system_error(errno, std::generic_category(), path);
+        ++finished;
+        std::cerr << '\r' << finished << '/' << todo.size() << " runs" << std::flush;
+      } catch (...) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!failure) failure = std::current_exception();
+        next = todo.size();   // stop handing out runs
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; ++t) {
+    workers.emplace_back(worker);
+  }
+  for (auto& w: workers) {
+    w.join();
+  }
+  if (!todo.empty()) std::cerr << '\n';
+  if (failure) std::rethrow_exception(failure);
+
+  auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  std::cerr << "Sweep: played " << finished << " runs in " << seconds << " s.\n";
+  return finished;
+}
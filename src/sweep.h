@@ -0,0 +1,141 @@
+#ifndef MESA_CRITTERS_SWEEP_H
+#define MESA_CRITTERS_SWEEP_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "critter.h"
+#include "world_generator.h"
+
+/**
+ * Runs the simulation headless for every combination of a grid of parameters,
+ * several times each with different seeds, across all cores in one process.
+ *
+ * A parameter is set on the grid with a spec of the form name=values, where
+ * values is a single number, a comma separated list, or an inclusive range
+ * first:last:step.  For example, "f=50:250:50" or "s=10,50".
+ * The parameters are:
+ *
+ *     x, y          the world width and height
+ *     f, s, n       food, stones, and critters per species
+ *     stone_sleep   turns a critter sleeps after running into a stone
+ *     mating_rest   turns both parents rest after mating
+ *
+ * plus "seeds=count", the number of runs for each combination.
+ * Runs use the seeds first_seed, first_seed + 1, and so on,
+ * so every run can be repeated on its own with critters -H -r.
+ *
+ * Each worker keeps its world from run to run, and only builds a new one
+ * when the world size changes.  Combinations are ordered so that runs
+ * sharing a world size come together.
+ *
+ * Results are appended to a CSV file as each run finishes, one row per run:
+ * the parameters and seed, the ticks played, then alive, dead, kills, feedings,
+ * starved and score for each species.
+ * Rows are in the order runs finish, not the order of the grid.
+ * Runs already in the file are skipped, so an interrupted sweep is resumed
+ * by running it again with the same file.
+ *
+ * Critters are created on several threads at once,
+ * so they must not share mutable state between instances.
+ */
+class sweep {
+  public:
+    /**
+     * The number of parameters on the grid.
+     */
+    static constexpr std::size_t parameters = 7;
+    /**
+     * The name of each parameter, in the order of the CSV columns.
+     */
+    static const std::array<const char*, parameters> names;
+    /**
+     * The value of every parameter.
+     */
+    using settings = std::array<long, parameters>;
+    /**
+     * Makes a fresh critter for each species to take part, given the seed of the run.
+     * Called once per run, from the worker threads.
+     */
+    using roster = std::function<std::vector<std::shared_ptr<critter>>(uint64_t)>;
+
+    /**
+     * Create a sweep with one value for every parameter and one seed.
+     * @param defaults the value of each parameter not set on the grid,
+     *        in the order of names
+     * @param players the species to take part
+     * @param shape how to arrange each world
+     * @param ticks stop each run after this many ticks,
+     *        or 0 to run until one species is left
+     * @param first_seed the seed of the first run of each combination
+     */
+    sweep(const settings& defaults, roster players, const layout& shape,
+          unsigned long ticks, uint64_t first_seed);
+
+    /**
+     * Set the values of one parameter, or the number of seeds.
+     * @param spec name=values
+     * @throws std::invalid_argument if the spec can't be read
+     */
+    void add(const std::string& spec);
+
+    /**
+     * @return the number of runs on the grid
+     */
+    std::size_t size() const;
+
+    /**
+     * Play every run not already recorded in a results file.
+     * Progress is reported on std::cerr.
+     * @param path the CSV file to append results to
+     * @param threads the number of runs to play at once
+     * @return the number of runs played
+     * @throws std::invalid_argument if a combination doesn't fit in its world
+     * @throws std::runtime_error if the file holds the results of a different sweep
+     * @throws std::system_error if the file can't be read or written
+     */
+    std::size_t run(const std::string& path, unsigned threads);
+
+  private:
+    /**
+     * One run on the grid.
+     */
+    struct job {
+      settings values;    /**< the value of every parameter */
+      uint64_t seed;      /**< the seed of the run */
+    };
+
+    std::array<std::vector<long>, parameters> grid_;  /**< the values of each parameter */
+    std::size_t seeds_ = 1;         /**< runs for each combination */
+    roster players_;                /**< makes the species for a run */
+    layout shape_;                  /**< how each world is arranged */
+    unsigned long ticks_;           /**< ticks per run, or 0 to play each out */
+    uint64_t first_seed_;           /**< seed of the first run of each combination */
+    std::vector<std::string> species_;  /**< species names, in the order of the columns */
+
+    /**
+     * @return every run on the grid, with runs sharing a world size together
+     */
+    std::vector<job> jobs() const;
+    /**
+     * @return the header line of the results file, without a newline
+     */
+    std::string header() const;
+    /**
+     * @return the leading columns of the row for a run, which identify it
+     */
+    static std::string key(const job& j);
+    /**
+     * Find the runs already in a results file, dropping a partly written last row.
+     * @return the key of every run found
+     */
+    std::vector<std::string> recorded(const std::string& path) const;
+};
+
+#endif
+
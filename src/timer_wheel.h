@@ -0,0 +1,164 @@
+#ifndef MESA_CRITTERS_TIMER_WHEEL_H
+#define MESA_CRITTERS_TIMER_WHEEL_H
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+/**
+ * Holds items until the tick they are due, in a hierarchical timer wheel.
+ *
+ * The lowest level has a bucket for every tick of the current block of 256.
+ * Each level above has a bucket for every block of the level below, so three
+ * levels reach 2^24 ticks ahead; anything further waits in an overflow list.
+ * When the clock enters a new block, the block's bucket is emptied into the
+ * level below.  Scheduling and firing an item are constant time.
+ *
+ * @tparam T the type of the items
+ */
+template <class T>
+class timer_wheel {
+  public:
+    static constexpr int levels = 3;          /**< levels of buckets */
+    static constexpr int bits = 8;            /**< log2 of the buckets per level */
+    static constexpr std::size_t buckets = std::size_t(1) << bits;  /**< buckets per level */
+
+    /**
+     * Create an empty wheel.
+     * @param now the current tick
+     */
+    explicit timer_wheel(unsigned long now = 0) { reset(now); }
+
+    /**
+     * Drop every item and set the clock.
+     * @param now the current tick
+     */
+    void reset(unsigned long now) {
+      now_ = now;
+      size_ = 0;
+      for (auto& level: wheel_) {
+        for (auto& bucket: level) bucket.clear();
+      }
+      far_.clear();
+    }
+
+    /**
+     * @return the current tick
+     */
+    unsigned long now() const { return now_; }
+    /**
+     * @return the number of items waiting
+     */
+    std::size_t size() const { return size_; }
+
+    /**
+     * Hold an item until a tick.
+     * @param when the tick the item is due, which must be after now()
+     * @param item the item
+     */
+    void schedule(unsigned long when, T item) {
+      assert (when > now_);
+      ++size_;
+      place(entry {when, std::move(item)});
+    }
+
+    /**
+     * Move the clock forward, handing over every item that falls due on the way.
+     * Items are handed over in the order they fall due.
+     * @param to the tick to stop at
+     * @param fire a callable taking an item
+     */
+    template <class F>
+    void advance(unsigned long to, F&& fire) {
+      while (now_ < to) {
+        ++now_;
+        // entering a new block: spread its items over the level below, top down
+        for (int l = levels; l > 0; --l) {
+          if ((now_ & ((1ul << (bits * l)) - 1)) == 0) cascade(l);
+        }
+        auto& due = wheel_[0][now_ & (buckets - 1)];
+        if (due.empty()) continue;
+        // swap the bucket out, so items scheduled while firing don't disturb it
+        firing_.swap(due);
+        size_ -= firing_.size();
+        for (auto& e: firing_) {
+          fire(e.item);
+        }
+        firing_.clear();
+      }
+    }
+
+    /**
+     * @return the earliest tick an item is due, or the largest unsigned long if there are none
+     */
+    unsigned long next() const {
+      if (size_ == 0) return std::numeric_limits<unsigned long>::max();
+      for (int l = 0; l < levels; ++l) {
+        const auto shift = bits * l;
+        for (auto i = ((now_ >> shift) & (buckets - 1)) + 1; i < buckets; ++i) {
+          const auto& bucket = wheel_[l][i];
+          if (bucket.empty()) continue;
+          if (l == 0) return (now_ & ~(buckets - 1)) | i;
+          return earliest(bucket);
+        }
+      }
+      return earliest(far_);
+    }
+
+  private:
+    /**
+     * An item and the tick it is due.
+     */
+    struct entry {
+      unsigned long when;
+      T item;
+    };
+    using bucket = std::vector<entry>;
+
+    unsigned long now_ = 0;                                 /**< the current tick */
+    std::size_t size_ = 0;                                  /**< items waiting */
+    std::array<std::array<bucket, buckets>, levels> wheel_; /**< buckets, by level */
+    bucket far_;                                            /**< items beyond the top level */
+    bucket firing_;                                         /**< items being handed over */
+
+    /**
+     * Put an entry in the lowest level whose current block holds its tick.
+     */
+    void place(entry e) {
+      for (int l = 0; l < levels; ++l) {
+        const auto shift = bits * (l + 1);
+        if ((e.when >> shift) == (now_ >> shift)) {
+          wheel_[l][(e.when >> (bits * l)) & (buckets - 1)].push_back(std::move(e));
+          return;
+        }
+      }
+      far_.push_back(std::move(e));
+    }
+    /**
+     * Re-place the items of the block just entered at a level.
+     * @param l the level, or levels for the overflow list
+     */
+    void cascade(int l) {
+      auto& from = l == levels? far_: wheel_[l][(now_ >> (bits * l)) & (buckets - 1)];
+      if (from.empty()) return;
+      firing_.swap(from);
+      for (auto& e: firing_) {
+        place(std::move(e));
+      }
+      firing_.clear();
+    }
+    /**
+     * @return the earliest tick in a bucket
+     */
+    static unsigned long earliest(const bucket& b) {
+      auto when = std::numeric_limits<unsigned long>::max();
+      for (const auto& e: b) when = std::min(when, e.when);
+      return when;
+    }
+};
+
+#endif
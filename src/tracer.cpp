@@ -0,0 +1,145 @@
+#include <cerrno>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <system_error>
+#include <vector>
+
+#include "tracer.h"
+
+namespace {
+  /**
+   * The spans of one thread.
+   */
+  struct buffer {
+    std::deque<tracer::event> events;
+    uint64_t dropped = 0;
+  };
+
+  /**
+   * Everything the tracer shares between threads.
+   */
+  struct state {
+    std::mutex lock;                                // guards everything but the buffers' contents
+    std::vector<std::shared_ptr<buffer>> buffers;   // by thread, in the order they first traced
+    std::set<std::string> names;
+    std::string path;
+    std::ofstream out;
+    std::size_t most = 0;
+    uint64_t since = 0;                             // when tracing started
+  };
+
+  state& shared() {
+    static state s;
+    return s;
+  }
+
+  buffer& local() {
+    thread_local std::shared_ptr<buffer> mine;
+    if (!mine) {
+      mine = std::make_shared<buffer>();
+      auto& s = shared();
+      std::lock_guard<std::mutex> guard(s.lock);
+      s.buffers.push_back(mine);
+    }
+    return *mine;
+  }
+
+  void quoted(std::ostream& os, const char* text) {
+    os << '"';
+    for (; *text; ++text) {
+      auto c = *text;
+      if (c == '"' || c == '\\') {
+        os << '\\' << c;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        os << ' ';
+      } else {
+        os << c;
+      }
+    }
+    os << '"';
+  }
+
+  // the trace format counts in microseconds
+  void micros(std::ostream& os, uint64_t ns) {
+    os << ns / 1000 << '.' << std::setw(3) << std::setfill('0') << ns % 1000;
+  }
+} // end anonymous namespace
+
+void tracer::add(const event& e) {
+  auto& b = local();
+  if (b.events.size() < shared().most) {
+    b.events.push_back(e);
+  } else {
+    ++b.dropped;
+  }
+}
+
+void tracer::start(const std::string& path, std::size_t most) {
+  auto& s = shared();
+  std::lock_guard<std::mutex> guard(s.lock);
+  if (on()) return;
+  s.out.open(path);
+  if (!s.out) throw std::system_error(errno, std::generic_category(), path);
+  s.path = path;
+  s.most = most;
+  s.since = now();
+  on_.store(true, std::memory_order_relaxed);
+}
+
+void tracer::stop() {
+  auto& s = shared();
+  std::lock_guard<std::mutex> guard(s.lock);
+  if (!on()) return;
+  on_.store(false, std::memory_order_relaxed);
+
+  auto& out = s.out;
+  std::size_t written = 0;
+  uint64_t dropped = 0;
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"critters\"}}";
+  for (std::size_t t = 0; t < s.buffers.size(); ++t) {
+    const auto& b = *s.buffers[t];
+    dropped += b.dropped;
+    out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t + 1
+        << ",\"args\":{\"name\":\"thread " << t + 1 << "\"}}";
+    for (const auto& e : b.events) {
+      out << ",\n{\"name\":";
+      quoted(out, e.name);
+      out << ",\"cat\":";
+      quoted(out, e.category);
+      out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << t + 1 << ",\"ts\":";
+      micros(out, e.begin < s.since? 0: e.begin - s.since);
+      out << ",\"dur\":";
+      micros(out, e.end - e.begin);
+      if (e.arg_name) {
+        out << ",\"args\":{";
+        quoted(out, e.arg_name);
+        out << ':' << e.arg << '}';
+      }
+      out << '}';
+      ++written;
+    }
+  }
+  out << "\n]}\n";
+  out.close();
+
+  if (!out) {
+    std::cerr << "Can't write the trace to " << s.path << ".\n";
+    return;
+  }
+  std::cerr << "Wrote " << written << " trace events to " << s.path << ".\n";
+  if (dropped != 0) {
+    std::cerr << dropped << " more were left out; raise the limit to keep them.\n";
+  }
+}
+
+const char* tracer::intern(const std::string& name) {
+  auto& s = shared();
+  std::lock_guard<std::mutex> guard(s.lock);
+  return s.names.insert(name).first->c_str();
+}
@@ -4,9 +4,11 @@
 #include <map>
 #include <memory>
 #include <string>
-#include <unordered_map>
 
 #include "critter.h"
+#include "geometry.h"
+#include "occupancy.h"
+#include "perception.h"
 #include "point.h"
 #include "species.h"
 
@@ -38,8 +40,23 @@ class view {
      * @param it the Critter to draw
      */
     virtual void draw(const point& p, const critter& it) const = 0;
+    /**
+     * Let the view read the world, for views that don't keep every tile drawn.
+     * Called whenever the world is set up; the world outlives the view's use of it.
+     * By default, nothing is kept.
+     * @param geom maps positions in the world to storage slots
+     * @param occ what kind of thing occupies each tile
+     * @param tiles reads the tiles themselves
+     */
+    virtual void watch([[maybe_unused]] const world_geometry& geom,
+                       [[maybe_unused]] const occupancy& occ,
+                       [[maybe_unused]] const perception::oracle& tiles) {}
 
-    virtual void redraw(const std::unordered_map<point,  std::shared_ptr<critter>> tiles) = 0;
+    /**
+     * Finish a frame.
+     * Called once after all of the draws for a time step have been made.
+     */
+    virtual void redraw() = 0;
 
     /**
      * Update the the scores for all the Critters that are competing.
@@ -0,0 +1,423 @@
+#include <algorithm>
+#include <cerrno>
+#include <string>
+#include <map>
+#include <vector>
+
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "color.h"
+#include "view_ansi.h"
+
+using std::shared_ptr;
+
+namespace {
+  /**
+   * The ANSI color number of each color, in the order of the color enum.
+   */
+  constexpr uint8_t ansi[] = {0, 1, 2, 4, 3, 5, 6, 7};
+
+  constexpr uint8_t BLACK = uint8_t(color::BLACK);
+  constexpr uint8_t WHITE = uint8_t(color::WHITE);
+} // end anonymous namespace
+
+view_ansi::view_ansi(const int height, const int width)
+  : view(height, width)
+{
+  winsize ws {};
+  if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0) {
+    rows_ = ws.ws_row;
+    cols_ = ws.ws_col;
+  }
+  // the world may be larger than the screen, unlike in view_curses
+  screen_ht_ = std::max(0, rows_ - score_ht_);
+  screen_wd_ = cols_;
+  world_ht_ = height > 0? height: screen_ht_;
+  world_wd_ = width > 0?  width:  screen_wd_;
+  score_wd_ = cols_;
+
+  if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &saved_) == 0) {
+    auto raw = saved_;
+    raw.c_lflag &= ~tcflag_t(ICANON | ECHO);
+    raw.c_cc[VMIN] = 0;     // have read not wait for a keypress
+    raw.c_cc[VTIME] = 0;
+    raw_input_ = tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0;
+  }
+
+  // zoom out in powers of two until the whole world fits
+  while (screen_wd_ > 0 && screen_ht_ > 0 &&
+         ((world_wd_ + max_zoom_ - 1) / max_zoom_ > screen_wd_ ||
+          (world_ht_ + max_zoom_ - 1) / max_zoom_ > screen_ht_)) {
+    max_zoom_ *= 2;
+  }
+  // face 0 is an empty tile, whatever its color
+  face_of_.assign(256 * 8, no_face);
+  looks_.assign(1, cell{});
+  players_.assign(1, 0);
+  tiles_drawn_.assign(std::size_t(world_ht_) * world_wd_, 0);
+  look_at(max_zoom_, 0, 0);
+  score_.assign(std::size_t(score_ht_) * score_wd_, cell{' ', WHITE, uint8_t(color::BLUE)});
+  back_.assign(std::size_t(rows_) * cols_, cell{' ', WHITE, BLACK});
+  // nothing on the terminal matches this, so the first frame paints every cell
+  front_.assign(back_.size(), cell{'\0', 0xff, 0xff});
+  out_.reserve(back_.size() * 8);
+
+  // score screen, laid out as in view_curses::setup_score
+  for (int col = 0; col < score_wd_; ++col) {
+    print(0, col, "-");
+    print(score_ht_ - 1, col, "-");
+  }
+  for (int row = 0; row < score_ht_; ++row) {
+    auto edge = (row == 0 || row == score_ht_ - 1)? "+": "|";
+    print(row, 0, edge);
+    print(row, score_wd_ - 1, edge);
+  }
+  print(0, 2,  " Scores ");
+  print(0, 15, " Alive ");
+  print(0, 23, " Dead ");
+  print(0, 30, " Kills ");
+  print(0, 38, " Feedings ");
+  print(0, 49, " Starved ");
+  print(0, 59, " Score ");
+  print(score_ht_ - 1, 2,  " Move: ");
+  print(score_ht_ - 1, 15, " Normal:   ");
+  print(score_ht_ - 1, 28, " Asleep:   ");
+  print(score_ht_ - 1, 41, " Mating:   ");
+  print(score_ht_ - 1, 24, "X", color::WHITE, color::BLACK);
+  print(score_ht_ - 1, 37, "X", color::BLACK, color::WHITE);
+  print(score_ht_ - 1, 50, "X", color::WHITE, color::RED);
+
+  // alternate screen, hidden cursor, cleared to the world background
+  out_ = "\x1b[?1049h\x1b[?25l\x1b[0;37;40m\x1b[2J";
+  pen_fg_ = WHITE;
+  pen_bg_ = BLACK;
+  send();
+  active_ = true;
+}
+
+void view_ansi::teardown() {
+  if (!active_) return;
+  active_ = false;
+  out_ = "\x1b[0m\x1b[?25h\x1b[?1049l";
+  send();
+  if (raw_input_) tcsetattr(STDIN_FILENO, TCSANOW, &saved_);
+}
+
+void view_ansi::draw(const point& p, const critter& it) const {
+  if (p.x < 0 || p.y < 0 || p.x >= world_wd_ || p.y >= world_ht_) return;
+  // a species looks zoomed out as its members last looked awake, wherever they are.
+  // Whether a face is a species is only learned from the living: a ghost of a
+  // rewound frame is no player, but it has the face of the critter it was
+  auto f = face(it.glyph(), it.color());
+  if (it.is_player()) {
+    players_[f] = 1;
+    if (!it.is_asleep() && !it.is_mating()) looks_[f] = cell::of(it);
+  }
+  auto& drawn = tiles_drawn_[std::size_t(p.y) * world_wd_ + p.x];
+  auto was = drawn;
+  drawn = f;
+
+  if (p.x < view_x_ || p.y < view_y_) return;
+  auto bx = (p.x - view_x_) / zoom_;
+  auto by = (p.y - view_y_) / zoom_;
+  if (bx >= blocks_wd_ || by >= blocks_ht_) return;
+  auto i = std::size_t(by) * blocks_wd_ + bx;
+  if (zoom_ == 1) {
+    shown_[i] = cell::of(it);
+  } else if (was != f) {
+    --counts_[i * stride_ + was];
+    ++counts_[i * stride_ + f];
+    stale_[i] = 1;
+  }
+}
+
+void view_ansi::watch(const world_geometry&, const occupancy&, const perception::oracle& tiles) {
+  tiles_ = &tiles;
+  // a new world: nothing of the old one is on it
+  std::fill(tiles_drawn_.begin(), tiles_drawn_.end(), 0);
+  look_at(zoom_, view_x_, view_y_);
+}
+
+uint8_t view_ansi::face(char glyph, color c) const {
+  if (glyph == ' ') return 0;
+  auto& f = face_of_[std::size_t(static_cast<unsigned char>(glyph)) * 8 + (uint8_t(c) & 7)];
+  if (f != no_face) return f;
+  // past the last face, every new look shares it
+  if (looks_.size() == no_face) return no_face - 1;
+  f = uint8_t(looks_.size());
+  looks_.push_back(cell{glyph, c == color::BLACK? WHITE: uint8_t(c), BLACK});
+  players_.push_back(0);
+  if (looks_.size() > stride_) {
+    // make room in every block for twice as many faces
+    auto blocks = counts_.size() / stride_;
+    std::vector<uint32_t> wider(blocks * stride_ * 2);
+    for (std::size_t b = 0; b < blocks; ++b) {
+      std::copy_n(&counts_[b * stride_], stride_, &wider[b * stride_ * 2]);
+    }
+    counts_.swap(wider);
+    stride_ *= 2;
+  }
+  return f;
+}
+
+void view_ansi::count_blocks() const {
+  counts_.assign(std::size_t(blocks_wd_) * blocks_ht_ * stride_, 0);
+  auto y1 = std::min(world_ht_, view_y_ + blocks_ht_ * zoom_);
+  auto x1 = std::min(world_wd_, view_x_ + blocks_wd_ * zoom_);
+  for (int y = view_y_; y < y1; ++y) {
+    auto row = &counts_[std::size_t((y - view_y_) / zoom_) * blocks_wd_ * stride_];
+    const auto* drawn = &tiles_drawn_[std::size_t(y) * world_wd_];
+    for (int x = view_x_; x < x1; ++x) {
+      ++row[std::size_t((x - view_x_) / zoom_) * stride_ + drawn[x]];
+    }
+  }
+}
+
+void view_ansi::look_at(int zoom, int x, int y) {
+  zoom_ = std::max(1, std::min(zoom, max_zoom_));
+  view_x_ = std::max(0, std::min(x, world_wd_ - screen_wd_ * zoom_));
+  view_y_ = std::max(0, std::min(y, world_ht_ - screen_ht_ * zoom_));
+  blocks_wd_ = std::min(screen_wd_, (world_wd_ - view_x_ + zoom_ - 1) / zoom_);
+  blocks_ht_ = std::min(screen_ht_, (world_ht_ - view_y_ + zoom_ - 1) / zoom_);
+
+  auto blocks = std::size_t(blocks_wd_) * blocks_ht_;
+  shown_.assign(blocks, cell{});
+  // zoomed out, every block is counted now and summed up on the next frame
+  stale_.assign(blocks, zoom_ == 1? 0: 1);
+  if (zoom_ != 1) {
+    count_blocks();
+    return;
+  }
+  if (tiles_ == nullptr) return;
+  for (int row = 0; row < blocks_ht_; ++row) {
+    for (int col = 0; col < blocks_wd_; ++col) {
+      shown_[std::size_t(row) * blocks_wd_ + col] = cell::of(*tiles_->at(view_x_ + col, view_y_ + row));
+    }
+  }
+}
+
+cell view_ansi::summary(int bx, int by) const {
+  const auto* counts = &counts_[(std::size_t(by) * blocks_wd_ + bx) * stride_];
+  std::size_t best = 0;
+  uint32_t most = 0;
+  for (std::size_t f = 1; f < looks_.size(); ++f) {
+    if (players_[f] != 0 && counts[f] > most) {
+      most = counts[f];
+      best = f;
+    }
+  }
+  if (most > 0) return looks_[best];
+
+  // no critters: shade by how much of the block is taken
+  constexpr char shades[] = " .:-=+*#%@";
+  auto x0 = view_x_ + bx * zoom_;
+  auto y0 = view_y_ + by * zoom_;
+  auto total = std::size_t(std::min(x0 + zoom_, world_wd_) - x0) * std::size_t(std::min(y0 + zoom_, world_ht_) - y0);
+  auto taken = total - counts[0];
+  if (taken == 0) return cell{};
+  return cell{shades[1 + taken * 8 / total], WHITE, BLACK};
+}
+
+void view_ansi::print(int row, int col, const std::string& text, color fg, color bg) {
+  if (row < 0 || row >= score_ht_) return;
+  for (auto ch: text) {
+    if (col >= 0 && col < score_wd_) {
+      score_[std::size_t(row) * score_wd_ + col] = cell{ch, uint8_t(fg), uint8_t(bg)};
+    }
+    ++col;
+  }
+}
+
+void view_ansi::update_time(const unsigned long tick) {
+  print(score_ht_ - 1, 9, "      ");
+  print(score_ht_ - 1, 9, std::to_string(tick));
+}
+
+void view_ansi::update_score(const std::map<std::string, shared_ptr<species>> players) {
+  std::vector<shared_ptr<species>> dudes;
+  for (auto& p: players) {
+    dudes.push_back(p.second);
+  }
+  std::sort(dudes.begin(), dudes.end(),
+      [](shared_ptr<species> a, shared_ptr<species> b) {
+        return b->score() < a->score();
+      });
+
+  auto row = 1;
+  for (auto& d: dudes) {
+    print(row, 2, std::string(std::size_t(std::max(0, score_wd_ - 3)), ' '));
+    print(row, 2,  d->name());
+    print(row, 16, std::to_string(d->alive()));
+    print(row, 24, std::to_string(d->dead()));
+    print(row, 31, std::to_string(d->kills()));
+    print(row, 39, std::to_string(d->feedings()));
+    print(row, 50, std::to_string(d->starved()));
+    print(row, 60, std::to_string(d->score()));
+    ++row;
+  }
+}
+
+void view_ansi::show_help() {
+  if (help_) return;
+  help_ = true;
+  flush();
+}
+
+void view_ansi::hide_help() {
+  help_ = false;
+  flush();
+}
+
+char view_ansi::get_key() {
+  char c;
+  if (read(STDIN_FILENO, &c, 1) != 1) return 0;
+
+  // zoom about the middle of the screen, and pan by a quarter screen
+  auto span_x = screen_wd_ * zoom_;
+  auto span_y = screen_ht_ * zoom_;
+  auto mid_x = view_x_ + span_x / 2;
+  auto mid_y = view_y_ + span_y / 2;
+  switch (c) {
+    case 'i': look_at(zoom_ / 2, mid_x - span_x / 4, mid_y - span_y / 4); break;
+    case 'o': look_at(zoom_ * 2, mid_x - span_x,     mid_y - span_y);     break;
+    case 'w': look_at(zoom_, view_x_, view_y_ - span_y / 4); break;
+    case 's': look_at(zoom_, view_x_, view_y_ + span_y / 4); break;
+    case 'a': look_at(zoom_, view_x_ - span_x / 4, view_y_); break;
+    case 'd': look_at(zoom_, view_x_ + span_x / 4, view_y_); break;
+    default:  return c;
+  }
+  flush();
+  return c;
+}
+
+void view_ansi::compose() {
+  for (int row = 0; row < score_ht_ && row < rows_; ++row) {
+    std::copy_n(&score_[std::size_t(row) * score_wd_], std::min(score_wd_, cols_),
+                &back_[std::size_t(row) * cols_]);
+  }
+  std::fill(back_.begin() + std::ptrdiff_t(score_ht_) * cols_, back_.end(), cell{});
+  for (int row = 0; row < blocks_ht_; ++row) {
+    auto i = std::size_t(row) * blocks_wd_;
+    for (int col = 0; col < blocks_wd_; ++col, ++i) {
+      if (stale_[i] != 0) {
+        shown_[i] = summary(col, row);
+        stale_[i] = 0;
+      }
+    }
+    std::copy_n(&shown_[std::size_t(row) * blocks_wd_], blocks_wd_, &back_[std::size_t(row + score_ht_) * cols_]);
+  }
+  if (!help_) return;
+
+  // the help dialog, laid out as in view_curses::show_help
+  auto ht = std::min(13, rows_ / 2);
+  auto wd = cols_ / 2;
+  auto top = rows_ / 4;
+  auto left = cols_ / 4;
+  auto put = [&](int row, int col, const std::string& text) {
+    for (auto ch: text) {
+      if (row >= 0 && row < ht && col >= 0 && col < wd) {
+        back_[std::size_t(top + row) * cols_ + left + col] = cell{ch, WHITE, uint8_t(color::BLUE)};
+      }
+      ++col;
+    }
+  };
+  for (int row = 0; row < ht; ++row) {
+    auto edge = (row == 0 || row == ht - 1);
+    put(row, 0, std::string(std::size_t(wd), edge? '-': ' '));
+    put(row, 0, edge? "+": "|");
+    put(row, wd - 1, edge? "+": "|");
+  }
+  put(0, 2, " Commands Available ");
+  put(2, 5, "p:  Play / pause simulation ");
+  put(3, 5, "+:  Speed up simulation (can use =) ");
+  put(4, 5, "-:  Slow down simulation ");
+  put(5, 5, "e:  Export the recorded species counters ");
+  put(6, 5, ",/.:  Step back / forward one tick ");
+  put(7, 5, "</>:  Scrub back / forward 50 ticks ");
+  put(8, 5, "h:  Show this screen ");
+  put(9, 5, "q:  quit ");
+  put(10, 5, "i/o:  Zoom in / out ");
+  put(11, 5, "w/a/s/d:  Pan up / left / down / right ");
+}
+
+void view_ansi::flush() {
+  if (!active_) return;
+  compose();
+  out_.clear();
+
+  // where the terminal cursor is, or -1 if unknown
+  int cx = -1;
+  int cy = -1;
+  for (int row = 0; row < rows_; ++row) {
+    const auto* back = &back_[std::size_t(row) * cols_];
+    auto* front = &front_[std::size_t(row) * cols_];
+    for (int col = 0; col < cols_; ++col) {
+      const auto& want = back[col];
+      if (want == front[col]) continue;
+
+      if (cy != row || cx != col) {
+        // over a short run of unchanged cells in the current colors,
+        // writing them again is cheaper than moving the cursor
+        auto gap = col - cx;
+        auto same_pen = cy == row && gap > 0 && gap <= 4 &&
+          std::all_of(front + cx, front + col, [this](const cell& c) {
+              return c.fg == pen_fg_ && c.bg == pen_bg_;
+            });
+        if (same_pen) {
+          for (; cx < col; ++cx) out_ += front[cx].glyph;
+        } else {
+          out_ += "\x1b[";
+          append(unsigned(row + 1));
+          if (col > 0) {
+            out_ += ';';
+            append(unsigned(col + 1));
+          }
+          out_ += 'H';
+        }
+      }
+
+      if (want.fg != pen_fg_ || want.bg != pen_bg_) {
+        out_ += "\x1b[";
+        if (want.fg != pen_fg_) {
+          append(30u + ansi[want.fg]);
+          if (want.bg != pen_bg_) out_ += ';';
+        }
+        if (want.bg != pen_bg_) append(40u + ansi[want.bg]);
+        out_ += 'm';
+        pen_fg_ = want.fg;
+        pen_bg_ = want.bg;
+      }
+
+      out_ += want.glyph;
+      front[col] = want;
+      cy = row;
+      cx = col + 1;
+      // terminals disagree about where the cursor goes after the last column
+      if (cx == cols_) cy = -1;
+    }
+  }
+  send();
+}
+
+void view_ansi::append(unsigned int n) {
+  char digits[10];
+  auto len = 0;
+  do {
+    digits[len++] = char('0' + n % 10);
+    n /= 10;
+  } while (n != 0);
+  while (len > 0) out_ += digits[--len];
+}
+
+void view_ansi::send() {
+  std::size_t sent = 0;
+  while (sent < out_.size()) {
+    auto n = write(STDOUT_FILENO, out_.data() + sent, out_.size() - sent);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+    sent += std::size_t(n);
+  }
+}
@@ -0,0 +1,204 @@
+#ifndef MESA_CRITTERS_VIEW_ANSI_H
+#define MESA_CRITTERS_VIEW_ANSI_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <termios.h>
+
+#include "cell.h"
+#include "color.h"
+#include "critter.h"
+#include "geometry.h"
+#include "occupancy.h"
+#include "perception.h"
+#include "point.h"
+#include "species.h"
+#include "view.h"
+
+/**
+ * Renders the Critters world with raw ANSI escape sequences.
+ *
+ * The screen is kept in two buffers: the front buffer holds what the terminal
+ * is showing, and the back buffer what it should show.
+ * Each frame, only the cells that differ are sent, with the shortest cursor
+ * moves and color changes that will do, and the whole frame goes out in one write().
+ *
+ * The screen layout and colors are the same as view_curses.
+ *
+ * A world larger than the terminal is shown zoomed out, with each screen cell
+ * summing up a square block of tiles: the species with the most members in
+ * the block, or a shade for how full the block is if there are none.
+ * The zoom and the part of the world shown can be changed from the keyboard.
+ *
+ * The summaries are built from what was drawn, so a rewound frame is summed
+ * up as it was.  Each look drawn, a glyph in a color, is a face, and the view
+ * keeps one byte per tile, the face last drawn there, and a count of each face
+ * in every block on screen.  Drawing a tile moves one from the count of its old
+ * face to its new one, and only blocks whose counts changed are summed up again.
+ * Tiles scrolled into view at full zoom are read back from the world.
+ */
+class view_ansi : public view {
+  public:
+    /**
+     * Take over the terminal.
+     * @param height the desired height of the world, or 0 to fill the terminal.
+     *        May be larger than the terminal.
+     * @param width the desired width of the world, or 0 to fill the terminal.
+     *        May be larger than the terminal.
+     */
+    view_ansi(const int height, const int width);
+
+    /**
+     * Give the terminal back.
+     */
+    ~view_ansi() {
+      teardown();
+    }
+
+    /**
+     * Render Critters and other objects on the screen.
+     * Nothing is sent to the terminal until the frame is finished.
+     * @param p the location on the world screen
+     * @param it an entity to draw.
+     */
+    void draw(const point& p, const critter& it) const override;
+    /**
+     * Send everything that changed since the last frame to the terminal.
+     */
+    void redraw() override { flush(); }
+    /**
+     * @copydoc view::watch()
+     */
+    void watch(const world_geometry& geom, const occupancy& occ, const perception::oracle& tiles) override;
+    /**
+     * @copydoc view::update_score()
+     */
+    void update_score(const std::map<std::string, std::shared_ptr<species>> players) override;
+    /**
+     * @copydoc view::update_time()
+     */
+    void update_time(const unsigned long tick) override;
+    /**
+     * @copydoc view::show_help()
+     */
+    void show_help() override;
+    /**
+     * @copydoc view::hide_help()
+     */
+    void hide_help() override;
+    /**
+     * Get keyboard commands from the user.
+     * Zoom (i, o) and pan (w, a, s, d) keys are handled here as well as
+     * being passed on.
+     * @return the character pressed, or 0 if there is none
+     */
+    char get_key() override;
+
+    /**
+     * @copydoc view::height()
+     */
+    int  height() override { return world_ht_; }
+    /**
+     * @copydoc view::width()
+     */
+    int  width()  override { return world_wd_; }
+
+    /**
+     * Restore the terminal to the state it was found in.
+     */
+    void teardown() override;
+
+  private:
+    int rows_ = 24;                     /**< height of the terminal */
+    int cols_ = 80;                     /**< width of the terminal */
+    int world_ht_ = 0;                  /**< height of the world screen */
+    int world_wd_ = 0;                  /**< width of the world screen */
+    int score_ht_ = 10;                 /**< height of the score screen */
+    int score_wd_ = 0;                  /**< width of the score screen */
+    bool help_ = false;                 /**< true while the help dialog is shown */
+    bool active_ = false;               /**< true while the terminal is taken over */
+    termios saved_ {};                  /**< terminal settings to restore on teardown */
+    bool raw_input_ = false;            /**< true if saved_ must be restored */
+
+    int screen_ht_ = 0;                 /**< height of the part of the screen showing the world */
+    int screen_wd_ = 0;                 /**< width of the part of the screen showing the world */
+
+    const perception::oracle* tiles_ = nullptr;   /**< reads tiles back, once watched */
+
+    static constexpr uint8_t no_face = 0xff;      /**< in face_of_, a glyph and color not seen yet */
+    mutable std::vector<uint8_t> face_of_;        /**< the face of each glyph and color, 8 colors a glyph */
+    mutable std::vector<cell> looks_;             /**< how each face is shown zoomed out: as last seen awake */
+    mutable std::vector<uint8_t> players_;        /**< 1 for faces drawn as a member of a species */
+    mutable std::vector<uint8_t> tiles_drawn_;    /**< the face last drawn on each tile, row by row */
+
+    int zoom_ = 1;                      /**< width and height of a block, in tiles */
+    int max_zoom_ = 1;                  /**< the smallest zoom showing the whole world */
+    int view_x_ = 0;                    /**< leftmost tile shown */
+    int view_y_ = 0;                    /**< topmost tile shown */
+    int blocks_wd_ = 0;                 /**< number of blocks across the screen */
+    int blocks_ht_ = 0;                 /**< number of blocks down the screen */
+    mutable std::vector<cell> shown_;   /**< each block on screen: a tile at zoom 1, a summary otherwise */
+    mutable std::vector<uint8_t> stale_;  /**< 1 for blocks to sum up again before the next frame */
+    mutable std::vector<uint32_t> counts_;  /**< tiles of each face in each block on screen, zoomed out */
+    mutable std::size_t stride_ = 16;   /**< entries of counts_ per block: room for this many faces */
+
+    std::vector<cell> score_;           /**< the score screen */
+    std::vector<cell> back_;            /**< the whole terminal, as it should be */
+    std::vector<cell> front_;           /**< the whole terminal, as it is */
+    uint8_t pen_fg_ = 0xff;             /**< terminal foreground color as in cell, 0xff if unknown */
+    uint8_t pen_bg_ = 0xff;             /**< terminal background color as in cell, 0xff if unknown */
+    std::string out_;                   /**< bytes of the frame being built */
+
+    /**
+     * Write text onto the score screen.
+     * Text falling outside the screen is dropped.
+     */
+    void print(int row, int col, const std::string& text,
+               color fg = color::WHITE, color bg = color::BLUE);
+
+    /**
+     * Change the zoom and the part of the world shown, then fill in the blocks on screen.
+     * Both are clamped to sensible values.
+     * @param zoom the new zoom
+     * @param x the leftmost tile to show
+     * @param y the topmost tile to show
+     */
+    void look_at(int zoom, int x, int y);
+    /**
+     * Find the face of a look, making it one if it is new.
+     */
+    uint8_t face(char glyph, color c) const;
+    /**
+     * Count the faces of every tile in every block on screen.
+     */
+    void count_blocks() const;
+    /**
+     * Sum up a block of tiles in one cell.
+     * @param bx the column of the block on screen
+     * @param by the row of the block on screen
+     */
+    cell summary(int bx, int by) const;
+
+    /**
+     * Compose the score screen, world and help dialog into the back buffer.
+     */
+    void compose();
+    /**
+     * Send the differences between the back and front buffers to the terminal.
+     */
+    void flush();
+    /**
+     * Append a decimal number to out_.
+     */
+    void append(unsigned int n);
+    /**
+     * Write out_ to the terminal.
+     */
+    void send();
+};
+
+#endif
@@ -35,7 +35,7 @@ void view_curses::hide_help() {
   wrefresh(score_);
 }
 void view_curses::show_help() {
-  auto ht = std::min (8, maxheight_/2);
+  auto ht = std::min (11, maxheight_/2);
   help_ = newwin(ht, maxwidth_/2, maxheight_/4, maxwidth_/4);
   wbkgd(help_, COLOR_PAIR(1));
   box(help_, 0,0);
@@ -44,8 +44,11 @@ void view_curses::show_help() {
   mvwprintw(help_, 2, 5, "p:  Play / pause simulation ");
   mvwprintw(help_, 3, 5, "+:  Speed up simulation (can use =) ");
   mvwprintw(help_, 4, 5, "-:  Slow down simulation ");
-  mvwprintw(help_, 5, 5, "h:  Show this screen ");
-  mvwprintw(help_, 6, 5, "q:  quit ");
+  mvwprintw(help_, 5, 5, "e:  Export the recorded species counters ");
+  mvwprintw(help_, 6, 5, ",/.:  Step back / forward one tick ");
+  mvwprintw(help_, 7, 5, "</>:  Scrub back / forward 50 ticks ");
+  mvwprintw(help_, 8, 5, "h:  Show this screen ");
+  mvwprintw(help_, 9, 5, "q:  quit ");
 
   wrefresh(help_);
 }
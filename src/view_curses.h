@@ -4,7 +4,6 @@
 #include <cassert>
 #include <map>
 #include <string>
-#include <unordered_map>
 
 #include <ncurses.h>
 
@@ -55,8 +54,11 @@ class view_curses : public view {
      */
     void draw(const point& p, const critter& it) const override;
 
-    void redraw(const std::unordered_map<point,  std::shared_ptr<critter>> tiles) override {
-      assert (tiles.size() > 0);
+    /**
+     * @copydoc view::redraw()
+     */
+    void redraw() override {
+      wrefresh(world_);
     }
 
     /**
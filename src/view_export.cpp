@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+#include <system_error>
+#include <utility>
+
+#include "color.h"
+#include "view_export.h"
+
+namespace {
+  /**
+   * The RGB value of each color, in the order of the color enum.
+   * These are the xterm defaults.
+   */
+  constexpr std::array<std::array<unsigned char, 3>, 8> palette = {{
+    {{  0,   0,   0}},  // BLACK
+    {{205,   0,   0}},  // RED
+    {{  0, 205,   0}},  // GREEN
+    {{  0,   0, 238}},  // BLUE
+    {{205, 205,   0}},  // YELLOW
+    {{205,   0, 205}},  // MAGENTA
+    {{  0, 205, 205}},  // CYAN
+    {{229, 229, 229}},  // WHITE
+  }};
+
+  void put_varint(std::string& out, unsigned long n) {
+    while (n >= 0x80) {
+      out += char((n & 0x7f) | 0x80);
+      n >>= 7;
+    }
+    out += char(n);
+  }
+  void put_u16(std::string& out, unsigned n) {
+    out += char(n & 0xff);
+    out += char((n >> 8) & 0xff);
+  }
+} // end anonymous namespace
+
+view_export::view_export(const int height, const int width, const std::string& path, int cell_size)
+  : view(height, width)
+  , world_ht_(height)
+  , world_wd_(width)
+  , path_(path)
+  , images_(path.find('%') != std::string::npos)
+  , cell_size_(std::max(1, cell_size))
+  , world_(std::size_t(height) * width)
+{
+  if (!images_) {
+    stream_.open(path, std::ios::binary | std::ios::trunc);
+    if (!stream_) {
+      throw std::system_error(errno, std::generic_category(), path);
+    }
+    std::string header = "CRFS";
+    header += char(1);
+    put_u16(header, unsigned(width));
+    put_u16(header, unsigned(height));
+    stream_.write(header.data(), std::streamsize(header.size()));
+  }
+  encoder_ = std::thread(&view_export::encode, this);
+}
+
+void view_export::draw(const point& p, const critter& it) const {
+  world_[std::size_t(p.y) * world_wd_ + p.x] = cell::of(it);
+}
+
+void view_export::redraw() {
+  std::vector<cell> cells;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (queue_.size() >= queue_limit) {
+      ++dropped_;
+      return;
+    }
+    if (!spare_.empty()) {
+      cells = std::move(spare_.back());
+      spare_.pop_back();
+    }
+  }
+  // copy outside the lock, so the encoder is never kept waiting
+  cells.assign(world_.begin(), world_.end());
+  std::lock_guard<std::mutex> lock(lock_);
+  queue_.push_back(frame{tick_, std::move(cells)});
+  ready_.notify_one();
+}
+
+void view_export::teardown() {
+  if (!encoder_.joinable()) return;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    stopping_ = true;
+  }
+  ready_.notify_one();
+  encoder_.join();
+  if (stream_.is_open()) stream_.close();
+  std::cerr << "Exported " << written_ << " frames to " << path_
+            << ", dropped " << dropped_ << ".\n";
+}
+
+unsigned long view_export::dropped() const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return dropped_;
+}
+
+void view_export::encode() {
+  // the stream starts out blank, as does the world
+  std::vector<cell> previous(world_.size());
+  std::string out;
+
+  std::unique_lock<std::mutex> lock(lock_);
+  while (true) {
+    ready_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+    if (queue_.empty()) break;
+    auto f = std::move(queue_.front());
+    queue_.pop_front();
+    lock.unlock();
+
+    out.clear();
+    if (images_) {
+      write_image(f, out);
+    } else {
+      write_delta(f, previous, out);
+      stream_.write(out.data(), std::streamsize(out.size()));
+      std::swap(previous, f.cells);
+    }
+
+    lock.lock();
+    spare_.push_back(std::move(f.cells));
+    ++written_;
+  }
+}
+
+void view_export::write_delta(const frame& f, const std::vector<cell>& previous, std::string& out) {
+  std::string changes;
+  unsigned long count = 0;
+  std::size_t last = 0;
+  for (std::size_t i = 0; i < f.cells.size(); ++i) {
+    const auto& c = f.cells[i];
+    if (c == previous[i]) continue;
+    put_varint(changes, i - last);
+    changes += c.glyph;
+    changes += char((c.fg << 4) | c.bg);
+    last = i + 1;
+    ++count;
+  }
+  put_varint(out, f.tick);
+  put_varint(out, count);
+  out += changes;
+}
+
+void view_export::write_image(const frame& f, std::string& out) {
+  const auto width = world_wd_;
+  const auto height = world_ht_;
+  const auto cs = cell_size_;
+  out += "P6\n" + std::to_string(width * cs) + ' ' + std::to_string(height * cs) + "\n255\n";
+
+  for (int y = 0; y < height; ++y) {
+    const auto* row = &f.cells[std::size_t(y) * width];
+    for (int py = 0; py < cs; ++py) {
+      for (int x = 0; x < width; ++x) {
+        const auto& c = row[x];
+        for (int px = 0; px < cs; ++px) {
+          // the glyph is an inner square, leaving a border of background
+          auto inner = cs < 3 || (px > 0 && px < cs - 1 && py > 0 && py < cs - 1);
+          const auto& rgb = palette[(c.glyph != ' ' && inner)? c.fg: c.bg];
+          out.append(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+        }
+      }
+    }
+  }
+
+  char name[4096];
+  std::snprintf(name, sizeof(name), path_.c_str(), f.tick);
+  std::ofstream image(name, std::ios::binary | std::ios::trunc);
+  image.write(out.data(), std::streamsize(out.size()));
+  if (!image) {
+    std::cerr << "Could not write frame " << name << "\n";
+  }
+}
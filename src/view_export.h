@@ -0,0 +1,150 @@
+#ifndef MESA_CRITTERS_VIEW_EXPORT_H
+#define MESA_CRITTERS_VIEW_EXPORT_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cell.h"
+#include "critter.h"
+#include "point.h"
+#include "species.h"
+#include "view.h"
+
+/**
+ * Writes every frame of the simulation to disk, for turning into video later.
+ *
+ * Two formats are supported.
+ * An image sequence writes one binary PPM file per frame, each tile drawn
+ * as a square block of pixels in its background color with its glyph shown
+ * as an inner square in its foreground color.
+ * A frame stream writes all frames to one file, each frame holding only the
+ * cells that changed since the previous one:
+ *
+ *     header:  "CRFS", u8 version (1), u16 width, u16 height, little endian
+ *     frame:   varint tick, varint number of changes, then for each change:
+ *              varint cells skipped since the previous change, u8 glyph,
+ *              u8 colors (foreground << 4 | background)
+ *
+ * Varints are unsigned LEB128.  Cells are in row-major order, and colors are
+ * positions in the color enum.  Before the first frame, every cell is a
+ * blank, white on black.
+ *
+ * Frames are encoded on a background thread.
+ * If the encoder falls behind, frames are dropped rather than holding up the
+ * simulation; ticks in the stream and file names show where the gaps are.
+ */
+class view_export : public view {
+  public:
+    /**
+     * How many frames may wait for the encoder before new ones are dropped.
+     */
+    static constexpr std::size_t queue_limit = 16;
+
+    /**
+     * Start exporting.
+     * @param height the height of the world
+     * @param width the width of the world
+     * @param path the frame stream file, or a printf pattern taking the tick
+     *        as an unsigned long (for example "frames/%06lu.ppm") to write an image sequence
+     * @param cell_size the width and height of a tile in pixels, for image sequences
+     * @throws std::system_error if the frame stream can't be created
+     */
+    view_export(const int height, const int width, const std::string& path, int cell_size = 4);
+    /**
+     * Finish writing the frames already taken.
+     */
+    ~view_export() {
+      teardown();
+    }
+
+    /**
+     * @copydoc view::draw()
+     */
+    void draw(const point& p, const critter& it) const override;
+    /**
+     * Hand the finished frame to the encoder.
+     */
+    void redraw() override;
+    /**
+     * Scores are not exported.
+     */
+    void update_score(const std::map<std::string, std::shared_ptr<species>> players) override {
+      (void)players;
+    }
+    /**
+     * @copydoc view::update_time()
+     */
+    void update_time(const unsigned long tick) override { tick_ = tick; }
+    /**
+     * There is no help to show.
+     */
+    void show_help() override {}
+    /**
+     * There is no help to hide.
+     */
+    void hide_help() override {}
+    /**
+     * There is no keyboard.
+     * @return 0 always
+     */
+    char get_key() override { return 0; }
+    /**
+     * Wait for the encoder to catch up, then report how many frames were written and dropped.
+     */
+    void teardown() override;
+
+    /**
+     * @return the number of frames dropped so far
+     */
+    unsigned long dropped() const;
+
+  private:
+    /**
+     * A frame waiting to be encoded.
+     */
+    struct frame {
+      unsigned long tick;       /**< the tick the frame shows */
+      std::vector<cell> cells;  /**< every tile, in row-major order */
+    };
+
+    int world_ht_;                      /**< height of the world */
+    int world_wd_;                      /**< width of the world */
+    std::string path_;                  /**< file or file name pattern to write to */
+    bool images_ = false;               /**< true to write an image sequence */
+    int cell_size_ = 4;                 /**< pixels per tile, for image sequences */
+    std::ofstream stream_;              /**< the frame stream */
+    unsigned long tick_ = 0;            /**< the tick being drawn */
+    mutable std::vector<cell> world_;   /**< the frame being drawn */
+
+    mutable std::mutex lock_;           /**< guards everything below */
+    std::condition_variable ready_;     /**< signalled when a frame is queued, or on stop */
+    std::deque<frame> queue_;           /**< frames waiting for the encoder */
+    std::vector<std::vector<cell>> spare_;  /**< frame buffers to reuse */
+    unsigned long written_ = 0;         /**< frames encoded */
+    unsigned long dropped_ = 0;         /**< frames dropped because the queue was full */
+    bool stopping_ = false;             /**< set to have the encoder finish */
+    std::thread encoder_;               /**< runs encode() */
+
+    /**
+     * Encode queued frames until stopping_ is set and the queue is empty.
+     */
+    void encode();
+    /**
+     * Append the cells of f that differ from previous to the frame stream.
+     */
+    void write_delta(const frame& f, const std::vector<cell>& previous, std::string& out);
+    /**
+     * Write f as a PPM image.
+     */
+    void write_image(const frame& f, std::string& out);
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef MESA_CRITTERS_VIEW_HEADLESS_H
+#define MESA_CRITTERS_VIEW_HEADLESS_H
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "critter.h"
+#include "point.h"
+#include "species.h"
+#include "view.h"
+
+/**
+ * A view that renders nothing.
+ * Used to run the simulation as fast as possible without a terminal,
+ * for example in batch runs or when the world is watched some other way.
+ */
+class view_headless : public view {
+  public:
+    /**
+     * Create a headless world of a fixed size.
+     * @param height the height of the world
+     * @param width the width of the world
+     */
+    view_headless(const int height, const int width)
+      : view(height, width)
+    {}
+
+    /**
+     * @copydoc view::draw()
+     */
+    void draw(const point& p, const critter& it) const override {
+      (void)p; (void)it;
+    }
+    /**
+     * @copydoc view::redraw()
+     */
+    void redraw() override {}
+    /**
+     * @copydoc view::update_score()
+     */
+    void update_score(const std::map<std::string, std::shared_ptr<species>> players) override {
+      (void)players;
+    }
+    /**
+     * @copydoc view::update_time()
+     */
+    void update_time(const unsigned long tick) override { (void)tick; }
+    /**
+     * @copydoc view::show_help()
+     */
+    void show_help() override {}
+    /**
+     * @copydoc view::hide_help()
+     */
+    void hide_help() override {}
+    /**
+     * There is no keyboard.
+     * @return 0 always
+     */
+    char get_key() override { return 0; }
+    /**
+     * @copydoc view::teardown()
+     */
+    void teardown() override {}
+};
+
+#endif
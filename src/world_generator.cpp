@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "world_generator.h"
+
+world_generator::world_generator(int width, int height, uint64_t seed)
+  : width_(width)
+  , height_(height)
+  , gen_(seed)
+{}
+
+std::size_t world_generator::pick(int x0, int y0, int w, int h) {
+  auto x = (x0 + std::uniform_int_distribution<int> {0, w - 1} (gen_)) % width_;
+  auto y = (y0 + std::uniform_int_distribution<int> {0, h - 1} (gen_)) % height_;
+  if (x < 0) x += width_;
+  if (y < 0) y += height_;
+  return std::size_t(y) * width_ + x;
+}
+
+std::vector<occupancy::kind> world_generator::plan(std::size_t stones, std::size_t food,
+                                                   const std::vector<population>& species,
+                                                   const layout& shape) {
+  auto total = stones + food;
+  for (const auto& p: species) total += p.count;
+  if (total > std::size_t(width_) * height_) {
+    throw std::length_error("more items than tiles in the world");
+  }
+  tiles_.assign(std::size_t(width_) * height_, occupancy::EMPTY);
+
+  // structured parts first; whatever they can't place is scattered with the rest
+  std::vector<occupancy::kind> items;
+  if (shape.walls) stones -= lay_walls(stones);
+  if (shape.patches) food -= lay_patches(food);
+  items.insert(items.end(), stones, occupancy::STONE);
+  items.insert(items.end(), food, occupancy::FOOD);
+  for (std::size_t i = 0; i < species.size(); ++i) {
+    auto left = species[i].count;
+    if (shape.regions) left -= lay_region(species[i], i, species.size());
+    items.insert(items.end(), left, species[i].kind);
+  }
+  scatter(items);
+  return std::move(tiles_);
+}
+
+std::size_t world_generator::lay_walls(std::size_t stones) {
+  std::size_t placed = 0;
+  // give up on a crowded world rather than hunting for space forever
+  for (std::size_t tries = 0; placed < stones && tries < 4 * stones; ++tries) {
+    auto start = pick(0, 0, width_, height_);
+    int x = int(start % width_);
+    int y = int(start / width_);
+    auto length = std::uniform_int_distribution<int> {4, 16} (gen_);
+    auto across = std::uniform_int_distribution<int> {0, 1} (gen_) == 0;
+    for (int i = 0; i < length && placed < stones; ++i) {
+      auto p = across? pick(x + i, y, 1, 1): pick(x, y + i, 1, 1);
+      if (tiles_[p] != occupancy::EMPTY) break;
+      tiles_[p] = occupancy::STONE;
+      ++placed;
+    }
+  }
+  return placed;
+}
+
+std::size_t world_generator::lay_patches(std::size_t food) {
+  if (food == 0) return 0;
+  // patches of about 40 items, each packed into a square about twice its area
+  constexpr std::size_t per_patch = 40;
+  const auto patches = (food + per_patch - 1) / per_patch;
+  const auto side = std::max(3, int(std::ceil(std::sqrt(2.0 * double(food) / double(patches)))));
+  std::size_t placed = 0;
+  for (std::size_t i = 0; i < patches; ++i) {
+    auto corner = pick(0, 0, width_, height_);
+    int x0 = int(corner % width_);
+    int y0 = int(corner / width_);
+    auto want = (food - placed + patches - i - 1) / (patches - i);
+    for (std::size_t tries = 0, n = 0; n < want && tries < 4 * want; ++tries) {
+      auto p = pick(x0, y0, std::min(side, width_), std::min(side, height_));
+      if (tiles_[p] != occupancy::EMPTY) continue;
+      tiles_[p] = occupancy::FOOD;
+      ++n;
+      ++placed;
+    }
+  }
+  return placed;
+}
+
+std::size_t world_generator::lay_region(const population& p, std::size_t band, std::size_t bands) {
+  const int x0 = int(std::size_t(width_) * band / bands);
+  const int x1 = int(std::size_t(width_) * (band + 1) / bands);
+  if (x1 <= x0) return 0;
+  std::size_t placed = 0;
+  for (std::size_t tries = 0; placed < p.count && tries < 4 * p.count; ++tries) {
+    auto slot = pick(x0, 0, x1 - x0, height_);
+    if (tiles_[slot] != occupancy::EMPTY) continue;
+    tiles_[slot] = p.kind;
+    ++placed;
+  }
+  return placed;
+}
+
+void world_generator::scatter(std::vector<occupancy::kind>& items) {
+  std::shuffle(items.begin(), items.end(), gen_);
+  auto free = std::size_t(std::count(tiles_.begin(), tiles_.end(), occupancy::EMPTY));
+  auto next = items.begin();
+  for (auto& tile: tiles_) {
+    if (next == items.end()) break;
+    if (tile != occupancy::EMPTY) continue;
+    // take this tile with probability (items left) / (empty tiles left)
+    auto left = std::size_t(items.end() - next);
+    if (std::uniform_int_distribution<std::size_t> {0, free - 1} (gen_) < left) {
+      tile = *next++;
+    }
+    --free;
+  }
+}
@@ -0,0 +1,97 @@
+#ifndef MESA_CRITTERS_WORLD_GENERATOR_H
+#define MESA_CRITTERS_WORLD_GENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "occupancy.h"
+
+/**
+ * How the things in a new world are arranged.
+ * By default, everything is scattered uniformly at random.
+ */
+struct layout {
+  bool walls = false;     /**< line stones up into short straight walls */
+  bool patches = false;   /**< gather food into patches */
+  bool regions = false;   /**< start each species in its own band of the world */
+};
+
+/**
+ * Decides where everything in a new world goes.
+ *
+ * The result is a plan: the kind of every tile, in row-major order.
+ * Structured arrangements are laid down first; everything left over is then
+ * scattered over the remaining empty tiles in a single pass,
+ * choosing each tile with the probability still needed (selection sampling)
+ * and filling the chosen tiles from a shuffled list of items.
+ *
+ * The same seed and inputs always give the same plan.
+ */
+class world_generator {
+  public:
+    /**
+     * The number of members of one species to place.
+     */
+    struct population {
+      occupancy::kind kind;   /**< the kind of the species */
+      std::size_t count;      /**< how many to place */
+    };
+
+    /**
+     * Create a generator for a world.
+     * @param width the width of the world
+     * @param height the height of the world
+     * @param seed the seed for every random choice
+     */
+    world_generator(int width, int height, uint64_t seed);
+
+    /**
+     * Plan a world.
+     * @param stones the number of stones to place
+     * @param food the number of food items to place
+     * @param species the members of each species to place
+     * @param shape how to arrange them
+     * @return the kind of every tile, indexed by y * width + x
+     * @throws std::length_error if there are more items than tiles
+     */
+    std::vector<occupancy::kind> plan(std::size_t stones, std::size_t food,
+                                      const std::vector<population>& species,
+                                      const layout& shape);
+
+  private:
+    int width_;                             /**< width of the world */
+    int height_;                            /**< height of the world */
+    std::mt19937_64 gen_;                   /**< source of every random choice */
+    std::vector<occupancy::kind> tiles_;    /**< the plan being built */
+
+    /**
+     * Pick a tile uniformly from a rectangle, wrapping around the world edges.
+     */
+    std::size_t pick(int x0, int y0, int w, int h);
+    /**
+     * Put stones into straight walls of random length and direction.
+     * @return the number of stones placed
+     */
+    std::size_t lay_walls(std::size_t stones);
+    /**
+     * Put food into roughly square patches around random centers.
+     * @return the number of food items placed
+     */
+    std::size_t lay_patches(std::size_t food);
+    /**
+     * Put the members of a species at random in one band of the world.
+     * @param band the band, counting from the left
+     * @param bands the number of bands
+     * @return the number of members placed
+     */
+    std::size_t lay_region(const population& p, std::size_t band, std::size_t bands);
+    /**
+     * Scatter items over the empty tiles in one pass.
+     * @param items the kind of each item to place; shuffled in place
+     */
+    void scatter(std::vector<occupancy::kind>& items);
+};
+
+#endif
@@ -0,0 +1,117 @@
+/**
+ * Plays fixed scenarios headless and compares how they end with golden values.
+ *
+ * The golden file has one block per scenario: the tick and a checksum of the
+ * whole saved world, then the counters of every species.
+ * Any change to the engine that changes what happens in a game shows up here;
+ * if the change is meant to, record new golden values with --record.
+ *
+ * usage: critters-golden golden-file [scenario...]
+ *        critters-golden --record golden-file
+ */
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "scenario.h"
+
+namespace {
+  const std::vector<scenario> scenarios = {
+    {"all",     80,  24, 250, 10, 25, {"walker", "seeker", "fighter", "coward"}, layout {},                 1, 1000},
+    {"duel",    60,  30, 150, 20, 40, {"seeker", "fighter"},                     layout {true, true, false}, 42, 2000},
+    {"regions", 120, 40, 400, 30, 30, {"walker", "coward", "fighter"},           layout {false, false, true}, 7, 1500},
+  };
+
+  /**
+   * @return how a scenario ends, as it appears in the golden file
+   */
+  std::string play(const scenario& s) {
+    game g;
+    set_up(g, s);
+    g.play(s.ticks);
+
+    std::ostringstream out;
+    out << "scenario " << s.name << " tick " << g.ticks()
+        << " checksum " << std::hex << std::setw(16) << std::setfill('0') << checksum(g) << std::dec << '\n';
+    for (const auto& p : g.scores()) {
+      const auto& c = *p.second;
+      out << "  " << c.name() << " alive " << c.alive() << " dead " << c.dead() << " kills " << c.kills()
+          << " feedings " << c.feedings() << " starved " << c.starved() << '\n';
+    }
+    return out.str();
+  }
+
+  /**
+   * @return the block of every scenario in a golden file, by name
+   */
+  std::map<std::string, std::string> read(std::istream& in) {
+    std::map<std::string, std::string> blocks;
+    std::string line, name;
+    while (std::getline(in, line)) {
+      if (line.empty() || line[0] == '#') continue;
+      if (line.compare(0, 9, "scenario ") == 0) {
+        std::istringstream words(line.substr(9));
+        words >> name;
+      }
+      blocks[name] += line + '\n';
+    }
+    return blocks;
+  }
+} // end anonymous namespace
+
+int main(int argc, char** argv) {
+  if (argc >= 3 && std::strcmp(argv[1], "--record") == 0) {
+    std::ofstream out(argv[2]);
+    out << "# how each scenario of tests/golden.cpp ends; written by critters-golden --record\n";
+    for (const auto& s : scenarios) {
+      out << play(s);
+    }
+    if (!out) {
+      std::cerr << "Can't write " << argv[2] << '\n';
+      return 1;
+    }
+    std::cout << "Recorded " << scenarios.size() << " scenarios in " << argv[2] << '\n';
+    return 0;
+  }
+  if (argc < 2) {
+    std::cerr << "usage: " << argv[0] << " golden-file [scenario...]\n"
+              << "       " << argv[0] << " --record golden-file\n";
+    return 2;
+  }
+
+  std::ifstream in(argv[1]);
+  if (!in) {
+    std::cerr << "Can't read " << argv[1] << '\n';
+    return 2;
+  }
+  auto golden = read(in);
+
+  int played = 0, failed = 0;
+  for (const auto& s : scenarios) {
+    bool wanted = argc == 2;
+    for (int i = 2; i < argc; ++i) {
+      wanted = wanted || s.name == argv[i];
+    }
+    if (!wanted) continue;
+
+    ++played;
+    auto got = play(s);
+    if (got == golden[s.name]) {
+      std::cout << s.name << ": ok\n";
+    } else {
+      ++failed;
+      std::cout << s.name << ": differs from the golden values\n"
+                << "expected:\n" << golden[s.name] << "got:\n" << got;
+    }
+  }
+  if (played == 0) {
+    std::cerr << "No such scenario\n";
+    return 2;
+  }
+  return failed == 0? 0: 1;
+}
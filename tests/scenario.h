@@ -0,0 +1,60 @@
+#ifndef MESA_CRITTERS_TESTS_SCENARIO_H
+#define MESA_CRITTERS_TESTS_SCENARIO_H
+
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "game.h"
+#include "reference_critters.h"
+#include "view_headless.h"
+
+/**
+ * A headless run with everything fixed: the world, the species, the seed and the length.
+ */
+struct scenario {
+  std::string name;                     /**< how the scenario is known in the golden file */
+  int width;                            /**< world width */
+  int height;                           /**< world height */
+  int food;                             /**< food on the board */
+  int stones;                           /**< stones on the board */
+  int critters;                         /**< critters of each species */
+  std::vector<std::string> species;     /**< reference critters taking part */
+  layout shape;                         /**< how the world is arranged */
+  uint64_t seed;                        /**< seeds the world and the critters */
+  unsigned long ticks;                  /**< ticks to play */
+};
+
+/**
+ * Set up a game for a scenario.
+ * @param g a game with no world yet
+ * @param s the scenario
+ * @param work busy work for each move of a reference critter
+ */
+inline void set_up(game& g, const scenario& s, unsigned work = 0) {
+  g.set_view(std::make_unique<view_headless>(s.height, s.width));
+  g.set_seed(s.seed);
+  std::vector<std::pair<std::shared_ptr<critter>, int>> players;
+  for (const auto& name : s.species) {
+    players.emplace_back(reference_critter::make(name, {s.seed, work}), s.critters);
+  }
+  g.generate(s.stones, s.food, players, s.shape);
+}
+
+/**
+ * @return a 64 bit FNV-1a hash of the saved state of a game
+ */
+inline uint64_t checksum(const game& g) {
+  std::ostringstream out;
+  g.save(out);
+  uint64_t h = 14695981039346656037ull;
+  for (auto c : out.str()) {
+    h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+  }
+  return h;
+}
+
+#endif
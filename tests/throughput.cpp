@@ -0,0 +1,158 @@
+/**
+ * Measures how fast a busy headless world plays,
+ * and fails if that is too far below the baseline for this kind of build.
+ *
+ * Ticks per second depend on the machine, so they are measured against a
+ * reference workload timed in the same run, which sorts and hashes numbers
+ * and owes nothing to the simulator.  The speed kept is how many ticks the
+ * busy world plays in the time the reference takes for one round, and that
+ * changes far less from machine to machine than either does alone.
+ *
+ * The baseline file has one line per build type: the type, then ticks per round.
+ * Builds of a type not in it are skipped.
+ * --record replaces the line for this build type.
+ *
+ * usage: critters-throughput baseline-file tolerance
+ *        critters-throughput --record baseline-file
+ * where tolerance is the largest slowdown allowed, as a fraction: 0.4 allows 40%.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "scenario.h"
+
+#ifndef CRITTERS_BUILD_TYPE
+#  define CRITTERS_BUILD_TYPE ""
+#endif
+
+namespace {
+  const scenario busy = {"busy", 120, 60, 800, 40, 60, {"walker", "seeker", "fighter", "coward"}, layout {}, 1, 1000};
+
+  // skipped tests exit with this, as CTest is told
+  constexpr int skipped = 77;
+
+  /**
+   * @return the build type, as it appears in the baseline file
+   */
+  std::string build_type() {
+    std::string type = CRITTERS_BUILD_TYPE;
+    return type.empty()? "default": type;
+  }
+
+  /**
+   * @return the best ticks per second of a few runs of the busy scenario
+   */
+  double ticks_per_second() {
+    double best = 0;
+    for (int run = 0; run < 3; ++run) {
+      game g;
+      set_up(g, busy);
+      auto started = std::chrono::steady_clock::now();
+      g.play(busy.ticks);
+      std::chrono::duration<double> took = std::chrono::steady_clock::now() - started;
+      best = std::max(best, double(g.ticks()) / took.count());
+    }
+    return best;
+  }
+
+  /**
+   * @return the best rounds per second of a few runs of the reference workload
+   */
+  double rounds_per_second() {
+    constexpr int rounds = 20;
+    double best = 0;
+    volatile std::size_t kept = 0;    // so the work can't be optimized away
+    for (int run = 0; run < 3; ++run) {
+      std::mt19937 gen(1);
+      auto started = std::chrono::steady_clock::now();
+      for (int round = 0; round < rounds; ++round) {
+        std::vector<uint32_t> numbers(1 << 15);
+        for (auto& n : numbers) n = gen() % 100000;
+        std::sort(numbers.begin(), numbers.end());
+        std::unordered_set<uint32_t> seen(numbers.begin(), numbers.end());
+        kept = kept + seen.size();
+      }
+      std::chrono::duration<double> took = std::chrono::steady_clock::now() - started;
+      best = std::max(best, rounds / took.count());
+    }
+    return best;
+  }
+
+  /**
+   * @return ticks of the busy scenario per round of the reference workload
+   */
+  double measure() {
+    auto ticks = ticks_per_second();
+    auto rounds = rounds_per_second();
+    std::cout << ticks << " ticks per second, " << rounds << " reference rounds per second\n";
+    return ticks / rounds;
+  }
+
+  /**
+   * @return the ticks per second of every build type in a baseline file
+   */
+  std::map<std::string, double> read(const std::string& path) {
+    std::map<std::string, double> baselines;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+      if (line.empty() || line[0] == '#') continue;
+      std::istringstream words(line);
+      std::string type;
+      double rate;
+      if (words >> type >> rate) baselines[type] = rate;
+    }
+    return baselines;
+  }
+} // end anonymous namespace
+
+int main(int argc, char** argv) {
+  if (argc >= 3 && std::strcmp(argv[1], "--record") == 0) {
+    auto baselines = read(argv[2]);
+    auto rate = measure();
+    baselines[build_type()] = rate;
+    std::ofstream out(argv[2]);
+    out << "# ticks of the busy scenario of tests/throughput.cpp per round of its reference workload,\n"
+        << "# by build type; written by critters-throughput --record\n";
+    for (const auto& b : baselines) {
+      out << b.first << ' ' << b.second << '\n';
+    }
+    if (!out) {
+      std::cerr << "Can't write " << argv[2] << '\n';
+      return 1;
+    }
+    std::cout << "Recorded " << rate << " ticks per round for " << build_type() << " builds in " << argv[2] << '\n';
+    return 0;
+  }
+  if (argc < 3) {
+    std::cerr << "usage: " << argv[0] << " baseline-file tolerance\n"
+              << "       " << argv[0] << " --record baseline-file\n";
+    return 2;
+  }
+
+  auto tolerance = std::strtod(argv[2], nullptr);
+  auto baselines = read(argv[1]);
+  auto baseline = baselines.find(build_type());
+  if (baseline == baselines.end()) {
+    std::cout << "No baseline for " << build_type() << " builds in " << argv[1] << "; skipped.\n"
+              << "Record one with " << argv[0] << " --record " << argv[1] << '\n';
+    return skipped;
+  }
+
+  auto rate = measure();
+  auto least = baseline->second * (1 - tolerance);
+  std::cout << rate << " ticks per round; the baseline is " << baseline->second
+            << ", and at least " << least << " is needed.\n";
+  return rate >= least? 0: 1;
+}